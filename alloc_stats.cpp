@@ -0,0 +1,68 @@
+#include "alloc_stats.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<bool> enabled(false);
+static std::atomic<unsigned long> alloc_count(0);
+static std::atomic<unsigned long> free_count(0);
+
+static void* allocate(std::size_t size) {
+    if (enabled.load(std::memory_order_relaxed))
+        alloc_count.fetch_add(1, std::memory_order_relaxed);
+    void* ptr = std::malloc(size > 0 ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+static void deallocate(void* ptr) {
+    if (!ptr)
+        return;
+    if (enabled.load(std::memory_order_relaxed))
+        free_count.fetch_add(1, std::memory_order_relaxed);
+    std::free(ptr);
+}
+
+void AllocStats::enable() {
+    enabled = true;
+}
+
+AllocStats AllocStats::get() {
+    return {
+        alloc_count.load(std::memory_order_relaxed),
+        free_count.load(std::memory_order_relaxed)};
+}
+
+AllocStats AllocStats::operator-(const AllocStats& other) const {
+    return {alloc_num - other.alloc_num, free_num - other.free_num};
+}
+
+std::ostream& operator<<(std::ostream& os, const AllocStats& stats) {
+    return os << "heap allocations: " << stats.alloc_num
+              << ", frees: " << stats.free_num;
+}
+
+void* operator new(std::size_t size) {
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size) {
+    return allocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    deallocate(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    deallocate(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    deallocate(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    deallocate(ptr);
+}
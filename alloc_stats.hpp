@@ -0,0 +1,23 @@
+#ifndef ANTVIEW_ALLOC_STATS_HPP_
+#define ANTVIEW_ALLOC_STATS_HPP_
+
+#include <ostream>
+
+// Heap allocation counters.
+// Linking alloc_stats.cpp replaces global operator new/delete;
+// counting is off until enabled, so disabled counters cost one
+// relaxed load per call.
+struct AllocStats {
+    static void enable();
+    static AllocStats get();
+
+    // Counts since `other' snapshot
+    AllocStats operator-(const AllocStats& other) const;
+
+    unsigned long alloc_num;
+    unsigned long free_num;
+};
+
+std::ostream& operator<<(std::ostream& os, const AllocStats& stats);
+
+#endif
@@ -1,34 +1,18 @@
 #include "ant.hpp"
 #include <cassert>
 
-static char dir_to_char(Ant::Dir dir) {
+static char dir_to_char(AntBase::Dir dir) {
     switch (dir) {
-        case Ant::N: return '^';
-        case Ant::E: return '>';
-        case Ant::S: return 'v';
-        case Ant::W: return '<';
+        case AntBase::N: return '^';
+        case AntBase::E: return '>';
+        case AntBase::S: return 'v';
+        case AntBase::W: return '<';
         default: assert(false);
     }
 }
 
-std::ostream& operator<<(std::ostream& os, const Trail& trail) {
-    os << '(';
-    auto it = trail.begin();
-    for (; it != trail.end();) {
-        os << (*it);
-        ++it;
-        if (it != trail.end())
-            os << ' ';
-    }
-    os << ')';
-    return os;
-}
-
-std::ostream& operator<<(std::ostream& os, const Pos& pos) {
-    return os << '(' << pos.first << ' ' << pos.second << ')';
-}
-
-std::ostream& operator<<(std::ostream& os, const Ant& ant) {
+template<typename G>
+std::ostream& operator<<(std::ostream& os, const BasicAnt<G>& ant) {
     os << dir_to_char(ant.dir())
        << " (" << ant.x() << ", " << ant.y() << ") "
        << "eaten: " << ant.food_eaten() << " "
@@ -39,31 +23,97 @@ std::ostream& operator<<(std::ostream& os, const Ant& ant) {
     return os;
 }
 
-Ant::Ant()
-    : Ant(Trail()) {}
+template<typename G>
+BasicAnt<G>::BasicAnt()
+    : BasicAnt(Trail()) {}
 
-Ant::Ant(const Trail& trail)
-    : Ant(E, 0, 0, trail) {}
+template<typename G>
+BasicAnt<G>::BasicAnt(const Trail& trail)
+    : BasicAnt(E, 0, 0, Grid(trail)) {}
 
-Ant::Ant(Dir dir, Coord x, Coord y, const Trail& trail)
+template<typename G>
+BasicAnt<G>::BasicAnt(const Grid& grid)
+    : BasicAnt(E, 0, 0, grid) {}
+
+template<typename G>
+BasicAnt<G>::BasicAnt(Dir dir, Coord x, Coord y, const Trail& trail)
+    : BasicAnt(dir, x, y, Grid(trail)) {}
+
+template<typename G>
+BasicAnt<G>::BasicAnt(Dir dir, Coord x, Coord y, const Grid& grid)
     : dir_(dir), x_(x), y_(y),
-      trail_(trail), food_eaten_(0), action_num_(0)
+      grid_(grid), food_left_(grid.count()),
+      food_eaten_(0), action_num_(0),
+      base_(nullptr),
+      start_dir_(dir), start_x_(x), start_y_(y)
+{
+    eat();
+}
+
+template<typename G>
+BasicAnt<G>::BasicAnt(const Grid* base)
+    : BasicAnt(E, 0, 0, base) {}
+
+template<typename G>
+BasicAnt<G>::BasicAnt(Dir dir, Coord x, Coord y, const Grid* base)
+    : BasicAnt(dir, x, y, *base)
 {
+    base_ = base;
+}
+
+template<typename G>
+void BasicAnt<G>::reset() {
+    assert(base_ && "Ant has no base grid");
+    if (food_eaten_ <= UndoLogSize) {
+        // Put eaten food back
+        for (unsigned i = 0; i < food_eaten_; ++i) {
+            Cell cell = undo_log_[i];
+            grid_.set(grid_.cell_x(cell), grid_.cell_y(cell));
+        }
+    } else {
+        grid_.refill(*base_);
+    }
+    dir_ = start_dir_;
+    x_ = start_x_;
+    y_ = start_y_;
+    food_left_ += food_eaten_;
+    food_eaten_ = 0;
+    action_num_ = 0;
     eat();
 }
 
-void Ant::forward() {
+template<typename G>
+void BasicAnt<G>::restore(const State& state, const Cell* cells) {
+    assert(action_num_ == 0 && "Ant is not reset");
+    assert(state.food_eaten <= UndoLogSize);
+    assert(state.food_eaten >= food_eaten_);
+    for (unsigned i = food_eaten_; i < state.food_eaten; ++i) {
+        Cell cell = cells[i];
+        grid_.take(grid_.cell_x(cell), grid_.cell_y(cell));
+        undo_log_[i] = cell;
+    }
+    food_left_ -= state.food_eaten - food_eaten_;
+    food_eaten_ = state.food_eaten;
+    dir_ = state.dir;
+    x_ = state.x;
+    y_ = state.y;
+    action_num_ = state.action_num;
+}
+
+template<typename G>
+void BasicAnt<G>::forward() {
     ++action_num_;
     switch (dir_) {
-        case N: y_ = norm_y(y_ - 1); break;
-        case E: x_ = norm_y(x_ + 1); break;
-        case S: y_ = norm_y(y_ + 1); break;
-        case W: x_ = norm_x(x_ - 1); break;
+        case N: y_ = grid_.prev_y(y_); break;
+        case E: x_ = grid_.next_x(x_); break;
+        case S: y_ = grid_.next_y(y_); break;
+        case W: x_ = grid_.prev_x(x_); break;
     }
     eat();
 }
 
-void Ant::left() {
+template<typename G>
+void BasicAnt<G>::left() {
     ++action_num_;
     switch (dir_) {
         case N: dir_ = W; break;
@@ -73,7 +123,8 @@ void Ant::left() {
     }
 }
 
-void Ant::right() {
+template<typename G>
+void BasicAnt<G>::right() {
     ++action_num_;
     switch (dir_) {
         case N: dir_ = E; break;
@@ -83,37 +134,33 @@ void Ant::right() {
     }
 }
 
-bool Ant::is_food_ahead() const {
+template<typename G>
+bool BasicAnt<G>::is_food_ahead() const {
     switch (dir_) {
-        case N: return is_food_at_pos(x_, norm_y(y_ - 1));
-        case E: return is_food_at_pos(norm_x(x_ + 1), y_);
-        case S: return is_food_at_pos(x_, norm_y(y_ + 1));
-        case W: return is_food_at_pos(norm_x(x_ - 1), y_);
+        case N: return is_food_at_pos(x_, grid_.prev_y(y_));
+        case E: return is_food_at_pos(grid_.next_x(x_), y_);
+        case S: return is_food_at_pos(x_, grid_.next_y(y_));
+        case W: return is_food_at_pos(grid_.prev_x(x_), y_);
     }
     assert(false);
 }
 
-Coord Ant::norm_x(Coord x) {
-    Coord xn = x % MaxX;
-    if (xn < 0) xn = MaxX + xn;
-    return xn;
-}
-
-Coord Ant::norm_y(Coord y) {
-    Coord yn = y % MaxY;
-    if (yn < 0) yn = MaxY + yn;
-    return yn;
+template<typename G>
+bool BasicAnt<G>::is_food_at_pos(Coord x, Coord y) const {
+    return grid_.get(x, y);
 }
 
-bool Ant::is_food_at_pos(Coord x, Coord y) const {
-    return trail_.count(Pos(x, y)) > 0;
-}
-
-void Ant::eat() {
-    auto it = trail_.find(Pos(x_, y_));
-    if (it != trail_.end()) {
-        trail_.erase(it);
-        ++food_eaten_;
-    }
+template<typename G>
+void BasicAnt<G>::eat() {
+    unsigned food = grid_.take(x_, y_);
+    if (food && food_eaten_ < UndoLogSize)
+        undo_log_[food_eaten_] = grid_.cell(x_, y_);
+    food_eaten_ += food;
+    food_left_ -= food;
 }
 
+#define ANTVIEW_INSTANTIATE(World) \
+    template class BasicAnt<World>; \
+    template std::ostream& operator<<(std::ostream&, const BasicAnt<World>&);
+ANTVIEW_FOR_EACH_WORLD(ANTVIEW_INSTANTIATE)
+#undef ANTVIEW_INSTANTIATE
@@ -1,33 +1,73 @@
 #ifndef ANTVIEW_ANT_HPP_
 #define ANTVIEW_ANT_HPP_
 
-#include <set>
-#include <utility>
+#include <array>
+#include <cstdint>
 #include <ostream>
+#include "grid.hpp"
+#include "trail.hpp"
 
-using Coord = int;
-using Pos = std::pair<Coord, Coord>;
-using Trail = std::set<Pos>;
+// Directions and state, same for all worlds
+class AntBase {
+public:
+    enum Dir { N, E, S, W };
 
+    // Cell index, see BasicGrid::cell()
+    using Cell = std::uint32_t;
+
+    // Max. number of eaten cells reset() can restore one by one,
+    // base grid is copied instead when more food was eaten
+    static const unsigned UndoLogSize = 128;
+
+    // Ant state without grid, see restore()
+    struct State {
+        Dir dir;
+        Coord x;
+        Coord y;
+        unsigned food_eaten;
+        unsigned action_num;
+    };
+};
 
-std::ostream& operator<<(std::ostream& os, const Trail& trail);
-std::ostream& operator<<(std::ostream& os, const Pos& pos);
-class Ant;
-std::ostream& operator<<(std::ostream& os, const Ant& ant);
+template<typename G>
+class BasicAnt;
 
-class Ant {
+template<typename G>
+std::ostream& operator<<(std::ostream& os, const BasicAnt<G>& ant);
+
+// Ant in world `G', see geometry.hpp
+template<typename G>
+class BasicAnt : public AntBase {
 public:
-    enum Dir { N, E, S, W };
+    using World = G;
+    using Grid = BasicGrid<G>;
 
-    static Coord norm_x(Coord x);
-    static Coord norm_y(Coord y);
+    BasicAnt();
+    BasicAnt(const Trail& trail);
+    BasicAnt(const Grid& grid);
+    BasicAnt(Dir dir, Coord x, Coord y, const Trail& trail);
+    BasicAnt(Dir dir, Coord x, Coord y, const Grid& grid);
 
-    static const Coord MaxX = 32;
-    static const Coord MaxY = 32;
+    // Shared base grid, must outlive the ant; required by reset()
+    explicit BasicAnt(const Grid* base);
+    BasicAnt(Dir dir, Coord x, Coord y, const Grid* base);
 
-    Ant();
-    Ant(const Trail& trail);
-    Ant(Dir dir, Coord x, Coord y, const Trail& trail);
+    // Restore initial position and food
+    void reset();
+
+    State state() const {
+        return {dir_, x_, y_, food_eaten_, action_num_};
+    }
+
+    // Restore state reached from the start by eating `cells' in
+    // that order (see eaten_cells()), must be called right after reset()
+    void restore(const State& state, const Cell* cells);
+
+    // Cells eaten since the start in order;
+    // only first UndoLogSize cells are kept
+    const Cell* eaten_cells() const {
+        return undo_log_.data();
+    }
 
     void forward();
     void left();
@@ -47,20 +87,28 @@ public:
         return y_;
     }
 
+    Cell cell() const {
+        return grid_.cell(x_, y_);
+    }
+
     unsigned food_eaten() const {
         return food_eaten_;
     }
 
     unsigned food_left() const {
-        return trail_.size();
+        return food_left_;
     }
 
     unsigned action_num() const {
         return action_num_;
     }
 
-    const Trail& trail() const {
-        return trail_;
+    Trail trail() const {
+        return grid_.trail();
+    }
+
+    const Grid& grid() const {
+        return grid_;
     }
 
 private:
@@ -68,12 +116,23 @@ private:
 
     void eat();
 
+    using UndoLog = std::array<Cell, UndoLogSize>;
+
     Dir dir_;
     Coord x_;
     Coord y_;
-    Trail trail_;
+    Grid grid_;
+    unsigned food_left_;
     unsigned food_eaten_;
     unsigned action_num_;
+
+    const Grid* base_;
+    Dir start_dir_;
+    Coord start_x_;
+    Coord start_y_;
+    UndoLog undo_log_;
 };
 
+using Ant = BasicAnt<World32>;
+
 #endif
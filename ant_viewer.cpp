@@ -10,7 +10,7 @@
 
 static void usage(const std::string& name);
 
-static Trail load_trail_or_exit(const std::string& filename);
+static Trail load_trail_or_exit(const std::string& filename, Coord& size);
 
 static stree::Tree load_tree_or_exit(
     stree::Environment& env,
@@ -21,20 +21,27 @@ int main(int argc, char** argv) {
     // Check arguments
     if (argc < 3) usage(argv[0]);
 
-    // Initialize environment
-    stree::Environment env;
-    init_environment(env);
+    // Load trail, world depends on its size
+    Coord size;
+    Trail trail(load_trail_or_exit(argv[2], size));
 
-    // Load data
-    stree::Tree tree(load_tree_or_exit(env, argv[1]));
-    Trail trail(load_trail_or_exit(argv[2]));
+    return with_world(size, [&](auto world) {
+        using World = decltype(world);
 
-    AntViewerApp app(&env);
-    app.set_trail(std::move(trail));
-    app.set_tree(std::move(tree));
-    app.run("Ant Viewer", Ant::MaxX * 32, Ant::MaxY * 32);
+        // Initialize environment
+        stree::Environment env;
+        init_environment<BasicAnt<World>>(env);
 
-    return 0;
+        // Load tree
+        stree::Tree tree(load_tree_or_exit(env, argv[1]));
+
+        AntViewerApp<World> app(&env);
+        app.set_trail(std::move(trail), size);
+        app.set_tree(std::move(tree));
+        app.run("Ant Viewer", app.width(), app.height());
+
+        return 0;
+    });
 }
 
 
@@ -45,10 +52,10 @@ void usage(const std::string& name) {
     exit(-1);
 }
 
-Trail load_trail_or_exit(const std::string& filename) {
+Trail load_trail_or_exit(const std::string& filename, Coord& size) {
     try {
-        return load_trail(filename);
-    } catch (TrailParserException& e) {
+        return load_trail(filename, size);
+    } catch (std::exception& e) {
         std::cerr << e.what() << std::endl;
         std::exit(-1);
     }
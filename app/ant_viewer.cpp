@@ -3,23 +3,41 @@
 #include <iostream>
 #include <thread>
 #include "texture_manager.hpp"
+#include "../primitives.hpp"
 
 static const char AntTextureId[]  = "ant";
 static const char FoodTextureId[] = "food";
 
-void AntViewerApp::reset() {
-    ant_ = Ant(trail_);
+// Coordinate on torus of given size
+static Coord wrap(Coord c, Coord size) {
+    c %= size;
+    return (c < 0) ? c + size : c;
+}
+
+template<typename G>
+void AntViewerApp<G>::reset() {
+    ant_.reset();
+    pc_ = 0;
     if (exec_) exec_->restart();
+    follow_ant();
 }
 
-void AntViewerApp::step() {
-    if (exec_) {
+template<typename G>
+void AntViewerApp<G>::step() {
+    if (use_program_) {
+        if (program_.size() > 0) {
+            pc_ = program_.step(ant_, pc_);
+            std::cout << ant_ << std::endl;
+        }
+    } else if (exec_) {
         exec_->step();
         std::cout << ant_ << std::endl;
     }
+    follow_ant();
 }
 
-void AntViewerApp::print_backtrace() {
+template<typename G>
+void AntViewerApp<G>::print_backtrace() {
     if (exec_) {
         stree::ExecDebug debug(*exec_);
         debug.print_backtrace(std::cout);
@@ -27,12 +45,32 @@ void AntViewerApp::print_backtrace() {
     }
 }
 
-void AntViewerApp::set_trail(Trail trail) {
+template<typename G>
+void AntViewerApp<G>::toggle_program() {
+    use_program_ = !use_program_;
+    std::cout << "Mode: "
+              << (use_program_ ? "compiled program" : "stree::Exec")
+              << std::endl;
+    if (use_program_)
+        std::cout << program_;
+    reset();
+}
+
+template<typename G>
+void AntViewerApp<G>::set_trail(Trail trail, Coord size) {
     trail_ = std::move(trail);
+    grid_ = Grid(trail_, size, size);
+    ant_ = Ant(&grid_);
+    grid_x_ = std::min<int>(grid_.width(), MaxViewSize);
+    grid_y_ = std::min<int>(grid_.height(), MaxViewSize);
+    cell_size_ = std::max(1, MaxWindowSize / std::max(grid_x_, grid_y_));
+    view_x_ = 0;
+    view_y_ = 0;
     reset();
 }
 
-void AntViewerApp::set_tree(stree::Tree&& tree) {
+template<typename G>
+void AntViewerApp<G>::set_tree(stree::Tree&& tree) {
     tree_.swap(std::move(tree));
     exec_.reset(
         new stree::Exec(
@@ -40,14 +78,17 @@ void AntViewerApp::set_tree(stree::Tree&& tree) {
             stree::Exec::FlagStopIfCostNotZero));
     exec_->init(&params_, &ant_);
     exec_->set_cost_limit(0);
+    program_ = compile_program(tree_);
     reset();
 }
 
-bool AntViewerApp::after_init() {
+template<typename G>
+bool AntViewerApp<G>::after_init() {
     return load_textures();
 }
 
-void AntViewerApp::handle_event(const SDL_Event& event) {
+template<typename G>
+void AntViewerApp<G>::handle_event(const SDL_Event& event) {
     switch (event.type) {
         case SDL_KEYDOWN:
             on_keydown(event.key);
@@ -55,17 +96,20 @@ void AntViewerApp::handle_event(const SDL_Event& event) {
     }
 }
 
-void AntViewerApp::do_render() {
+template<typename G>
+void AntViewerApp<G>::do_render() {
     render_grid();
     render_trail();
     render_ant();
 }
 
-void AntViewerApp::after_render() {
+template<typename G>
+void AntViewerApp<G>::after_render() {
     std::this_thread::sleep_for(std::chrono::milliseconds(5));
 }
 
-void AntViewerApp::on_keydown(const SDL_KeyboardEvent& event) {
+template<typename G>
+void AntViewerApp<G>::on_keydown(const SDL_KeyboardEvent& event) {
     switch (event.keysym.sym) {
         case SDLK_SPACE:
             step();
@@ -73,11 +117,15 @@ void AntViewerApp::on_keydown(const SDL_KeyboardEvent& event) {
         case SDLK_b:
             print_backtrace();
             break;
+        case SDLK_m:
+            toggle_program();
+            break;
 
     }
 }
 
-bool AntViewerApp::load_textures() {
+template<typename G>
+bool AntViewerApp<G>::load_textures() {
     bool ok = true;
     // Ant texture
     if (!texture_manager_.load(renderer_, AntTextureId, "ant.png")) {
@@ -92,7 +140,8 @@ bool AntViewerApp::load_textures() {
     return ok;
 }
 
-void AntViewerApp::render_grid() {
+template<typename G>
+void AntViewerApp<G>::render_grid() {
     SDL_SetRenderDrawColor(renderer_, 0, 0, 0, 255);
 
     // Horizontal lines
@@ -111,7 +160,8 @@ void AntViewerApp::render_grid() {
     }
 }
 
-void AntViewerApp::render_ant() {
+template<typename G>
+void AntViewerApp<G>::render_ant() {
     // angle
     float angle = 0.0;
     switch (ant_.dir()) {
@@ -122,23 +172,45 @@ void AntViewerApp::render_ant() {
     }
     // rect
     SDL_Rect dst_rect;
-    dst_rect.x = ant_.x() * cell_size_;
-    dst_rect.y = ant_.y() * cell_size_;
+    dst_rect.x = wrap(ant_.x() - view_x_, grid_.width()) * cell_size_;
+    dst_rect.y = wrap(ant_.y() - view_y_, grid_.height()) * cell_size_;
     dst_rect.w = cell_size_;
     dst_rect.h = cell_size_;
     // draw
     texture_manager_.draw(renderer_, AntTextureId, dst_rect, angle);
 }
 
-void AntViewerApp::render_trail() {
-    for (const Pos& pos : ant_.trail()) {
-        // rect
-        SDL_Rect dst_rect;
-        dst_rect.x = pos.first * cell_size_;
-        dst_rect.y = pos.second * cell_size_;
-        dst_rect.w = cell_size_;
-        dst_rect.h = cell_size_;
-        // draw
-        texture_manager_.draw(renderer_, FoodTextureId, dst_rect);
+template<typename G>
+void AntViewerApp<G>::render_trail() {
+    const Grid& grid = ant_.grid();
+    for (int i = 0; i < grid_y_; ++i) {
+        Coord y = wrap(view_y_ + i, grid.height());
+        for (int j = 0; j < grid_x_; ++j) {
+            Coord x = wrap(view_x_ + j, grid.width());
+            if (!grid.get(x, y))
+                continue;
+            // rect
+            SDL_Rect dst_rect;
+            dst_rect.x = j * cell_size_;
+            dst_rect.y = i * cell_size_;
+            dst_rect.w = cell_size_;
+            dst_rect.h = cell_size_;
+            // draw
+            texture_manager_.draw(renderer_, FoodTextureId, dst_rect);
+        }
     }
 }
+
+template<typename G>
+void AntViewerApp<G>::follow_ant() {
+    // Center view on the ant when it leaves the view
+    if (wrap(ant_.x() - view_x_, grid_.width()) >= grid_x_)
+        view_x_ = wrap(ant_.x() - grid_x_ / 2, grid_.width());
+    if (wrap(ant_.y() - view_y_, grid_.height()) >= grid_y_)
+        view_y_ = wrap(ant_.y() - grid_y_ / 2, grid_.height());
+}
+
+#define ANTVIEW_INSTANTIATE(World) \
+    template class AntViewerApp<World>;
+ANTVIEW_FOR_EACH_WORLD(ANTVIEW_INSTANTIATE)
+#undef ANTVIEW_INSTANTIATE
@@ -1,27 +1,57 @@
 #ifndef ANTVIEW_ANT_VIEWER_TRAIL_EDITOR_HPP_
 #define ANTVIEW_ANT_VIEWER_TRAIL_EDITOR_HPP_
 
+#include <algorithm>
 #include <memory>
 #include <utility>
 #include <SDL2/SDL.h>
 #include <stree/stree.hpp>
 #include "../ant.hpp"
+#include "../program.hpp"
 #include "sdl.hpp"
 
+// Viewer for ants in world `G', tree primitives must be registered
+// for the same world. Worlds larger than MaxViewSize are shown
+// through a view that follows the ant.
+template<typename G>
 class AntViewerApp : public SdlApp {
 public:
+    using Ant = BasicAnt<G>;
+    using Grid = BasicGrid<G>;
+
+    // Max. view side in cells
+    static const int MaxViewSize = 128;
+    // Max. window side in pixels
+    static const int MaxWindowSize = 1024;
+
     AntViewerApp(stree::Environment* env)
         : SdlApp(),
           tree_(env),
+          ant_(&grid_),
+          pc_(0),
+          use_program_(false),
           cell_size_(32),
           grid_x_(32),
-          grid_y_(32) {}
+          grid_y_(32),
+          view_x_(0),
+          view_y_(0) {}
+
+    // Window size, depends on trail
+    int width() const {
+        return cell_size_ * grid_x_;
+    }
+
+    int height() const {
+        return cell_size_ * grid_y_;
+    }
 
     void reset();
     void step();
     void print_backtrace();
+    void toggle_program();
 
-    void set_trail(Trail trail);
+    // Trail in world of given side
+    void set_trail(Trail trail, Coord size);
     void set_tree(stree::Tree&& tree);
 
 protected:
@@ -38,17 +68,26 @@ protected:
     void render_trail();
     void toggle_trail_pos(const Pos& pos);
 
+    // Move view to keep the ant visible
+    void follow_ant();
+
     Pos mouse_motion_to_pos(const SDL_MouseMotionEvent& motion);
 
     std::unique_ptr<stree::Exec> exec_;
     stree::Tree tree_;
     stree::Params params_;
-    Ant ant_;
     Trail trail_;
+    Grid grid_;
+    Ant ant_;
+    Program program_;
+    unsigned pc_;
+    bool use_program_;
 
     int cell_size_;
-    int grid_x_;
+    int grid_x_; // view size in cells
     int grid_y_;
+    Coord view_x_; // top left view cell
+    Coord view_y_;
 };
 
 #endif
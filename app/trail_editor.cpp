@@ -1,4 +1,5 @@
 #include "trail_editor.hpp"
+#include <algorithm>
 #include <chrono>
 #include <iostream>
 #include <thread>
@@ -17,8 +18,23 @@ void TrailEditorApp::handle_event(const SDL_Event& event) {
             break;
 
         case SDL_KEYDOWN:
-            if (event.key.keysym.sym == SDLK_SPACE)
-                std::cout << trail_ << std::endl;
+            switch (event.key.keysym.sym) {
+                case SDLK_SPACE:
+                    std::cout << trail_ << std::endl;
+                    break;
+                case SDLK_LEFT:
+                    scroll(-grid_x_ / 2, 0);
+                    break;
+                case SDLK_RIGHT:
+                    scroll(grid_x_ / 2, 0);
+                    break;
+                case SDLK_UP:
+                    scroll(0, -grid_y_ / 2);
+                    break;
+                case SDLK_DOWN:
+                    scroll(0, grid_y_ / 2);
+                    break;
+            }
             break;
     }
 }
@@ -62,9 +78,13 @@ void TrailEditorApp::render_grid() {
 
 void TrailEditorApp::render_trail() {
     for (const Pos& pos : trail_) {
+        Coord x = pos.first - view_x_;
+        Coord y = pos.second - view_y_;
+        if (x < 0 || x >= grid_x_ || y < 0 || y >= grid_y_)
+            continue;
         SDL_Rect dst_rect;
-        dst_rect.x = pos.first * cell_size_;
-        dst_rect.y = pos.second * cell_size_;
+        dst_rect.x = x * cell_size_;
+        dst_rect.y = y * cell_size_;
         dst_rect.w = cell_size_;
         dst_rect.h = cell_size_;
         texture_manager_.draw(renderer_, FoodTextureId, dst_rect);
@@ -80,6 +100,13 @@ void TrailEditorApp::toggle_trail_pos(const Pos& pos) {
     }
 }
 
+void TrailEditorApp::scroll(Coord dx, Coord dy) {
+    view_x_ = std::min(std::max(view_x_ + dx, 0), MaxWorldSize - grid_x_);
+    view_y_ = std::min(std::max(view_y_ + dy, 0), MaxWorldSize - grid_y_);
+}
+
 Pos TrailEditorApp::mouse_motion_to_pos(const SDL_MouseMotionEvent& motion) {
-    return Pos(motion.x / cell_size_, motion.y / cell_size_);
+    return Pos(
+        view_x_ + motion.x / cell_size_,
+        view_y_ + motion.y / cell_size_);
 }
@@ -6,13 +6,26 @@
 #include "../ant.hpp"
 #include "sdl.hpp"
 
+// Trail editor, shows 32x32 cells at a time,
+// arrow keys scroll the view
 class TrailEditorApp : public SdlApp {
 public:
     TrailEditorApp()
         : SdlApp(),
           cell_size_(32),
           grid_x_(32),
-          grid_y_(32) {}
+          grid_y_(32),
+          view_x_(0),
+          view_y_(0) {}
+
+    // Window size
+    int width() const {
+        return cell_size_ * grid_x_;
+    }
+
+    int height() const {
+        return cell_size_ * grid_y_;
+    }
 
     void set_trail(Trail trail) {
         trail_ = std::move(trail);
@@ -28,14 +41,17 @@ protected:
     void render_grid();
     void render_trail();
     void toggle_trail_pos(const Pos& pos);
+    void scroll(Coord dx, Coord dy);
 
     Pos mouse_motion_to_pos(const SDL_MouseMotionEvent& motion);
 
     Trail trail_;
 
     int cell_size_;
-    int grid_x_;
+    int grid_x_; // view size in cells
     int grid_y_;
+    Coord view_x_; // top left view cell
+    Coord view_y_;
 };
 
 #endif
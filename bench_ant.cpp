@@ -0,0 +1,299 @@
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <stree/stree.hpp>
+#include <streegp/streegp.hpp>
+#include "ant.hpp"
+#include "data.hpp"
+#include "jit.hpp"
+#include "lockstep.hpp"
+#include "primitives.hpp"
+#include "program.hpp"
+
+using Individual = stree::gp::Individual;
+using Population = stree::gp::Population<Individual>;
+using Fitness = stree::gp::Fitness;
+using TreeList = std::vector<stree::Tree*>;
+using GridList = std::vector<const Grid*>;
+
+struct NullEvaluator {
+    Fitness operator()(Individual&) {
+        return Fitness();
+    }
+};
+
+struct BenchResult {
+    double seconds;
+    unsigned long food_eaten;
+};
+
+static const unsigned StepLimit = 600;
+
+static void usage(const std::string& name);
+
+static BenchResult bench_exec(
+    const TreeList& trees, const Grid& grid, unsigned repeat);
+static BenchResult bench_bytecode(
+    const TreeList& trees, const Grid& grid, unsigned repeat);
+static BenchResult bench_jit(
+    const TreeList& trees, const Grid& grid, unsigned repeat);
+static BenchResult bench_lockstep(
+    const TreeList& trees, const Grid& grid, unsigned repeat);
+
+// Each tree on each of many trails
+static BenchResult bench_trails_bytecode(
+    const TreeList& trees, const GridList& grids, unsigned repeat);
+static BenchResult bench_trails_lockstep(
+    const TreeList& trees, const GridList& grids, unsigned repeat);
+
+static void bench(
+    const std::string& title,
+    const TreeList& trees,
+    const Grid& grid,
+    unsigned repeat);
+
+static void bench_trails(
+    const std::string& title,
+    const TreeList& trees,
+    const GridList& grids,
+    unsigned repeat);
+
+static void print_result(const std::string& name, const BenchResult& result, unsigned long runs);
+
+int main(int argc, char** argv) {
+    if (argc < 3)
+        usage(argv[0]);
+    unsigned population_size = (argc > 3) ? std::stoul(argv[3]) : 1000;
+    unsigned repeat = (argc > 4) ? std::stoul(argv[4]) : 10;
+
+    // Initialize environment
+    stree::Environment env;
+    init_environment(env);
+
+    // Load data, first trail is used for single trail benchmarks
+    std::vector<Grid> grids;
+    stree::Tree tree(&env);
+    try {
+        read_trails(
+            argv[1],
+            [&grids](Trail& trail) {
+                if (grids.size() < Lockstep::MaxLanes)
+                    grids.emplace_back(trail);
+            },
+            [&grids](const BinaryTrail& trail) {
+                if (grids.size() < Lockstep::MaxLanes)
+                    grids.emplace_back(trail);
+            });
+        if (grids.empty())
+            throw std::invalid_argument("No trails");
+        tree.swap(load_tree(env, argv[2]));
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        std::exit(-1);
+    }
+    const Grid& grid = grids.front();
+
+    // Single tree
+    bench("Tree", TreeList(population_size, &tree), grid, repeat);
+
+    // Random population
+    auto config = make_default_config();
+    config.set<unsigned>(stree::gp::conf::PopulationSize, population_size);
+    std::mt19937 prng(1);
+    NullEvaluator evaluator;
+    auto context = stree::gp::make_context<Individual>(
+        config, env, evaluator, prng);
+    Population population;
+    stree::gp::ramped_half_and_half(context, population);
+    TreeList trees;
+    for (Individual& individual : population)
+        trees.push_back(&individual.tree());
+    bench("Random population", trees, grid, repeat);
+
+    if (grids.size() > 1) {
+        GridList grid_list;
+        for (const Grid& item : grids)
+            grid_list.push_back(&item);
+        bench_trails(
+            "Random population on " + std::to_string(grids.size()) + " trails",
+            trees, grid_list, repeat);
+    }
+
+    return 0;
+}
+
+void usage(const std::string& name) {
+    using namespace std;
+    cout << "Usage:" << endl
+         << name << " <trail-filename> <tree-filename>"
+         << " [<population-size> [<repeat>]]" << endl
+         << "    trail file may hold many trails, up to "
+         << Lockstep::MaxLanes << " of them are used" << endl;
+    exit(-1);
+}
+
+void bench(
+    const std::string& title,
+    const TreeList& trees,
+    const Grid& grid,
+    unsigned repeat)
+{
+    unsigned long runs = static_cast<unsigned long>(trees.size()) * repeat;
+    std::cout << title << ": " << trees.size() << " trees x "
+              << repeat << " = " << runs << " runs" << std::endl;
+    print_result("exec", bench_exec(trees, grid, repeat), runs);
+    print_result("bytecode", bench_bytecode(trees, grid, repeat), runs);
+    if (JitBatch::is_supported())
+        print_result("jit", bench_jit(trees, grid, repeat), runs);
+    print_result("lockstep", bench_lockstep(trees, grid, repeat), runs);
+    std::cout << std::endl;
+}
+
+void bench_trails(
+    const std::string& title,
+    const TreeList& trees,
+    const GridList& grids,
+    unsigned repeat)
+{
+    unsigned long runs =
+        static_cast<unsigned long>(trees.size()) * grids.size() * repeat;
+    std::cout << title << ": " << trees.size() << " trees x "
+              << grids.size() << " trails x "
+              << repeat << " = " << runs << " runs" << std::endl;
+    print_result("bytecode", bench_trails_bytecode(trees, grids, repeat), runs);
+    print_result("lockstep", bench_trails_lockstep(trees, grids, repeat), runs);
+    std::cout << std::endl;
+}
+
+void print_result(const std::string& name, const BenchResult& result, unsigned long runs) {
+    std::cout << "  " << std::left << std::setw(10) << name << std::right
+              << std::fixed << std::setprecision(1)
+              << std::setw(10) << result.seconds * 1e3 << " ms"
+              << std::setw(10) << result.seconds * 1e9 / runs << " ns/run"
+              << "  food eaten: " << result.food_eaten
+              << std::endl;
+}
+
+template<typename F>
+static double measure(F fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+    return time.count();
+}
+
+BenchResult bench_exec(const TreeList& trees, const Grid& grid, unsigned repeat) {
+    BenchResult result{0.0, 0};
+    Ant ant(&grid);
+    result.seconds = measure([&]() {
+        for (unsigned i = 0; i < repeat; ++i) {
+            for (stree::Tree* tree : trees) {
+                ant.reset();
+                run_tree(*tree, ant, StepLimit);
+                result.food_eaten += ant.food_eaten();
+            }
+        }
+    });
+    return result;
+}
+
+BenchResult bench_bytecode(const TreeList& trees, const Grid& grid, unsigned repeat) {
+    BenchResult result{0.0, 0};
+    Ant ant(&grid);
+    result.seconds = measure([&]() {
+        for (unsigned i = 0; i < repeat; ++i) {
+            for (stree::Tree* tree : trees) {
+                Program program = compile_program(*tree);
+                ant.reset();
+                program.run(ant, StepLimit);
+                result.food_eaten += ant.food_eaten();
+            }
+        }
+    });
+    return result;
+}
+
+BenchResult bench_jit(const TreeList& trees, const Grid& grid, unsigned repeat) {
+    BenchResult result{0.0, 0};
+    Ant ant(&grid);
+    result.seconds = measure([&]() {
+        for (unsigned i = 0; i < repeat; ++i) {
+            JitBatch batch;
+            for (stree::Tree* tree : trees)
+                batch.add(compile_program(*tree));
+            batch.finalize();
+            for (std::size_t j = 0; j < batch.size(); ++j) {
+                ant.reset();
+                batch.run(j, ant, StepLimit);
+                result.food_eaten += ant.food_eaten();
+            }
+        }
+    });
+    return result;
+}
+
+// Each program runs on all lanes with the same trail,
+// time and food are per lane
+BenchResult bench_lockstep(const TreeList& trees, const Grid& grid, unsigned repeat) {
+    BenchResult result{0.0, 0};
+    Lockstep lockstep(std::vector<const Grid*>(Lockstep::MaxLanes, &grid));
+    result.seconds = measure([&]() {
+        for (unsigned i = 0; i < repeat; ++i) {
+            for (stree::Tree* tree : trees) {
+                Program program = compile_program(*tree);
+                lockstep.run(program, StepLimit, false);
+                for (unsigned lane = 0; lane < lockstep.lane_num(); ++lane)
+                    result.food_eaten += lockstep.food_eaten(lane);
+            }
+        }
+    });
+    result.seconds /= Lockstep::MaxLanes;
+    result.food_eaten /= Lockstep::MaxLanes;
+    return result;
+}
+
+// Trail after trail with cycle detection, as evaluator runs programs
+BenchResult bench_trails_bytecode(const TreeList& trees, const GridList& grids, unsigned repeat) {
+    BenchResult result{0.0, 0};
+    std::vector<Ant> ants;
+    for (const Grid* grid : grids)
+        ants.emplace_back(grid);
+    CycleDetector detector;
+    RunChecks checks;
+    checks.detector = &detector;
+    result.seconds = measure([&]() {
+        for (unsigned i = 0; i < repeat; ++i) {
+            for (stree::Tree* tree : trees) {
+                Program program = compile_program(*tree);
+                for (Ant& ant : ants) {
+                    ant.reset();
+                    program.run(ant, StepLimit, &checks);
+                    result.food_eaten += ant.food_eaten();
+                }
+            }
+        }
+    });
+    return result;
+}
+
+// One trail per lane with cycle detection
+BenchResult bench_trails_lockstep(const TreeList& trees, const GridList& grids, unsigned repeat) {
+    BenchResult result{0.0, 0};
+    Lockstep lockstep(grids);
+    result.seconds = measure([&]() {
+        for (unsigned i = 0; i < repeat; ++i) {
+            for (stree::Tree* tree : trees) {
+                Program program = compile_program(*tree);
+                lockstep.run(program, StepLimit);
+                for (unsigned lane = 0; lane < lockstep.lane_num(); ++lane)
+                    result.food_eaten += lockstep.food_eaten(lane);
+            }
+        }
+    });
+    return result;
+}
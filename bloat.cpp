@@ -0,0 +1,12 @@
+#include "bloat.hpp"
+
+bool BloatControl::is_killed(
+    std::size_t size,
+    double mean_size,
+    std::mt19937& prng) const
+{
+    if (size <= mean_size)
+        return false;
+    std::bernoulli_distribution dist(tarpeian_rate);
+    return dist(prng);
+}
@@ -0,0 +1,87 @@
+#ifndef ANTVIEW_BLOAT_HPP_
+#define ANTVIEW_BLOAT_HPP_
+
+#include <cstddef>
+#include <random>
+#include <vector>
+#include <streegp/streegp.hpp>
+#include "data.hpp"
+
+// Limits on offspring trees and selection pressure against large trees
+struct BloatControl {
+    BloatControl(
+        std::size_t size_max,
+        unsigned depth_max,
+        unsigned parsimony,
+        float tarpeian_rate,
+        unsigned tournament_size)
+        : size_max(size_max),
+          depth_max(depth_max),
+          parsimony(parsimony),
+          tarpeian_rate(tarpeian_rate),
+          tournament_size(tournament_size) {}
+
+    explicit BloatControl(const stree::gp::Config& config)
+        : BloatControl(
+            config.get<unsigned>(conf::TreeSizeMax),
+            config.get<unsigned>(conf::TreeDepthMax),
+            config.get<unsigned>(conf::Parsimony),
+            config.get<float>(conf::TarpeianRate),
+            config.get<unsigned>(conf::SelectionTournamentSize)) {}
+
+    // Check offspring tree against size and depth limits
+    bool fits(std::size_t size, unsigned depth) const {
+        return (size_max == 0 || size <= size_max)
+            && (depth_max == 0 || depth <= depth_max);
+    }
+
+    // Compare for tournament, lexicographic parsimony
+    // prefers smaller tree of equal fitness
+    bool is_better(
+        stree::gp::Fitness fitness1, std::size_t size1,
+        stree::gp::Fitness fitness2, std::size_t size2) const
+    {
+        if (fitness1 != fitness2)
+            return fitness1 < fitness2;
+        return parsimony == ParsimonyLexicographic && size1 < size2;
+    }
+
+    // Tarpeian method: new tree larger than average gets worst fitness
+    // without evaluation with probability `tarpeian_rate'
+    bool is_killed(std::size_t size, double mean_size, std::mt19937& prng) const;
+
+    std::size_t size_max;   // 0 is no limit
+    unsigned depth_max;     // 0 is no limit
+    unsigned parsimony;
+    float tarpeian_rate;
+    unsigned tournament_size;
+};
+
+// Index of best of `size' random individuals, or of worst
+// if `loser' is set; `fitness(index)' returns fitness
+template<typename F>
+std::size_t tournament(
+    const std::vector<std::size_t>& sizes,
+    F fitness,
+    const BloatControl& bloat,
+    unsigned size,
+    bool loser,
+    std::mt19937& prng)
+{
+    std::uniform_int_distribution<std::size_t> dist(0, sizes.size() - 1);
+    std::size_t result = dist(prng);
+    for (unsigned i = 1; i < size; ++i) {
+        std::size_t index = dist(prng);
+        bool is_better = bloat.is_better(
+            fitness(index), sizes[index],
+            fitness(result), sizes[result]);
+        bool is_worse = bloat.is_better(
+            fitness(result), sizes[result],
+            fitness(index), sizes[index]);
+        if (loser ? is_worse : is_better)
+            result = index;
+    }
+    return result;
+}
+
+#endif
@@ -0,0 +1,55 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "data.hpp"
+#include "grid.hpp"
+#include "trail.hpp"
+#include "trail_format.hpp"
+
+static void usage(const std::string& name);
+
+int main(int argc, char** argv) {
+    if (argc < 3)
+        usage(argv[0]);
+    std::string input = argv[1];
+    std::string output = argv[2];
+    std::string format = (argc > 3) ? argv[3] : "binary";
+    if (format != "binary" && format != "text")
+        usage(argv[0]);
+
+    try {
+        // Either format is detected on load, text output keeps
+        // only the trail, its world is the smallest one containing it
+        Coord size;
+        Trail trail = load_trail(input, size);
+
+        bool binary = (format == "binary");
+        std::ofstream file(
+            output, binary ? std::ios::out | std::ios::binary : std::ios::out);
+        if (!file.is_open())
+            throw std::invalid_argument("Cannot open output file");
+        if (binary) {
+            write_binary_trail(file, trail, size, size);
+        } else {
+            file << trail << std::endl;
+        }
+        if (!file)
+            throw std::runtime_error("Write failed");
+
+        std::cout << trail.size() << " positions, world size = "
+                  << size << "x" << size << std::endl;
+
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        std::exit(-1);
+    }
+    return 0;
+}
+
+void usage(const std::string& name) {
+    using namespace std;
+    cout << "Usage:" << endl
+         << name << " <input-filename> <output-filename> [binary|text]" << endl;
+    exit(-1);
+}
@@ -1,10 +1,18 @@
 #include "data.hpp"
+#include <algorithm>
 #include <cmath>
 #include <fstream>
+#include <iostream>
 #include <sstream>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "island.hpp"
+#include "mapped_file.hpp"
+#include "trail_format.hpp"
 #include "trail_parser.hpp"
 
 static std::ifstream open_file(const std::string& filepath);
+static Trail parse_trail(const MappedFile& file);
 
 static stree::gp::Config _make_default_config();
 static void prepare_config(stree::gp::Config& config);
@@ -33,12 +41,85 @@ stree::gp::Config load_config(const std::string& filename) {
 }
 
 Trail load_trail(const std::string& filename) {
-    auto file = open_file(filename);
-    TrailParser parser;
-    parser.parse(file);
-    if (!parser.is_done())
-        throw TrailParserException(parser);
-    return parser.result();
+    MappedFile file(filename);
+    if (is_binary_trail(file.data(), file.size()))
+        return BinaryTrail(file.data(), file.size()).trail();
+    return parse_trail(file);
+}
+
+Trail load_trail(const std::string& filename, Coord& size) {
+    MappedFile file(filename);
+    if (is_binary_trail(file.data(), file.size())) {
+        BinaryTrail trail(file.data(), file.size());
+        size = world_size(trail.width(), trail.height());
+        return trail.trail();
+    }
+    Trail trail = parse_trail(file);
+    size = world_size(trail);
+    return trail;
+}
+
+std::size_t read_trails(
+    const std::string& filename,
+    const std::function<void(Trail&)>& fn,
+    const std::function<void(const BinaryTrail&)>& binary_fn)
+{
+    std::size_t num = 0;
+    Trail trail;
+    if (filename == "-") {
+        TrailReader reader(std::cin);
+        for (; reader.next(trail); ++num)
+            fn(trail);
+        return num;
+    }
+
+    MappedFile file(filename);
+    if (is_binary_trail(file.data(), file.size())) {
+        binary_fn(BinaryTrail(file.data(), file.size()));
+        return 1;
+    }
+    TrailReader reader(file.data(), file.size());
+    for (; reader.next(trail); ++num)
+        fn(trail);
+    return num;
+}
+
+std::vector<std::string> list_trail_files(const std::string& path) {
+    std::vector<std::string> filenames;
+
+    struct stat info;
+    if (stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+        // All regular files in directory
+        DIR* dir = opendir(path.c_str());
+        if (!dir)
+            throw std::invalid_argument("Cannot open directory `" + path + "'");
+        while (struct dirent* entry = readdir(dir)) {
+            if (entry->d_name[0] == '.')
+                continue;
+            std::string filename = path + "/" + entry->d_name;
+            if (stat(filename.c_str(), &info) == 0 && S_ISREG(info.st_mode))
+                filenames.push_back(filename);
+        }
+        closedir(dir);
+        std::sort(filenames.begin(), filenames.end());
+        if (filenames.empty())
+            throw std::invalid_argument("No trails in `" + path + "'");
+        return filenames;
+    }
+
+    // Comma separated list
+    std::string::size_type pos = 0;
+    for (;;) {
+        std::string::size_type next = path.find(',', pos);
+        std::string filename = path.substr(pos, next - pos);
+        if (filename.empty())
+            throw std::invalid_argument("Empty trail filename");
+        filenames.push_back(filename);
+        if (next == std::string::npos)
+            break;
+        pos = next + 1;
+    }
+    return filenames;
 }
 
 stree::Tree load_tree(stree::Environment& env, const std::string& filename) {
@@ -57,6 +138,16 @@ std::ifstream open_file(const std::string& filepath) {
     return file;
 }
 
+Trail parse_trail(const MappedFile& file) {
+    TrailParser parser;
+    parser.parse(file.data(), file.size());
+    if (!parser.is_done()) {
+        parser.finish();
+        throw TrailParserException(parser);
+    }
+    return parser.move_result();
+}
+
 static stree::gp::Config _make_default_config() {
     auto config = stree::gp::make_default_config();
     config.set_order_step(1);
@@ -68,6 +159,34 @@ static stree::gp::Config _make_default_config() {
     config.set<float>(conf::FitnessGoal, 0.0);
     config.set<unsigned>(conf::ResultNum, 10);
     config.set<unsigned>(conf::StepLimit, 600);
+    config.set<unsigned>(conf::StepLimitInitial, 0);
+    config.set<unsigned>(conf::Threads, 0);
+    config.set<unsigned>(conf::EvalMode, EvalBytecode);
+    config.set<unsigned>(conf::PruneEvaluation, 0);
+    config.set<unsigned>(conf::FitnessCacheSize, 65536);
+    config.set<unsigned>(conf::CheckpointInterval, 50);
+    config.set<unsigned>(conf::TrailSampleSize, 0);
+
+    config.set_order(60);
+    config.set<unsigned>(conf::IslandNum, 1);
+    config.set<unsigned>(conf::MigrationInterval, 10);
+    config.set<unsigned>(conf::MigrationSize, 5);
+    config.set<unsigned>(conf::MigrationTopology, TopologyRing);
+
+    config.set_order(70);
+    config.set<unsigned>(conf::SteadyState, 0);
+    config.set<unsigned>(conf::EvaluationMax, 0);
+    config.set<unsigned>(conf::ReplacementTournamentSize, 3);
+
+    config.set_order(80);
+    config.set<unsigned>(conf::FlatTrees, 0);
+    config.set<unsigned>(conf::FlatMutationDepth, 5);
+
+    config.set_order(90);
+    config.set<unsigned>(conf::TreeSizeMax, 500);
+    config.set<unsigned>(conf::TreeDepthMax, 17);
+    config.set<unsigned>(conf::Parsimony, ParsimonyNone);
+    config.set<float>(conf::TarpeianRate, 0.3);
 
     config.set_order(250);
     config.set<unsigned>(conf::MutationNum, 0);
@@ -100,9 +219,60 @@ static void prepare_config(stree::gp::Config& config) {
     if (config.get<unsigned>(conf::StepLimit) == 0)
         throw ConfigError("StepLimit is zero");
 
+    if (config.get<unsigned>(conf::StepLimitInitial)
+        > config.get<unsigned>(conf::StepLimit))
+        throw ConfigError("StepLimitInitial is > StepLimit");
+
     if (config.get<unsigned>(conf::ResultNum) == 0)
         throw ConfigError("ResultNum is zero");
 
+    if (config.get<unsigned>(conf::EvalMode) > EvalLockstep)
+        throw ConfigError("EvalMode is invalid");
+
+    if (config.get<unsigned>(conf::IslandNum) == 0)
+        throw ConfigError("IslandNum is zero");
+
+    if (config.get<unsigned>(conf::MigrationInterval) == 0)
+        throw ConfigError("MigrationInterval is zero");
+
+    if (config.get<unsigned>(conf::MigrationSize)
+        > config.get<unsigned>(stree::gp::conf::PopulationSize))
+        throw ConfigError("MigrationSize is > PopulationSize");
+
+    if (config.get<unsigned>(conf::MigrationTopology) > TopologyAll)
+        throw ConfigError("MigrationTopology is invalid");
+
+    if (config.get<unsigned>(conf::ReplacementTournamentSize) == 0)
+        throw ConfigError("ReplacementTournamentSize is zero");
+
+    if (config.get<unsigned>(conf::Parsimony) > ParsimonyTarpeian)
+        throw ConfigError("Parsimony is invalid");
+
+    if (config.get<float>(conf::TarpeianRate) < 0.0
+        || config.get<float>(conf::TarpeianRate) > 1.0)
+        throw ConfigError("TarpeianRate is out of range");
+
+    // Steady state has no generations to change trails,
+    // step limit or to exchange individuals at,
+    // flat tree mode doesn't support them either
+    bool steady_state = config.get<unsigned>(conf::SteadyState);
+    bool flat_trees = config.get<unsigned>(conf::FlatTrees);
+    if (steady_state && flat_trees)
+        throw ConfigError("SteadyState and FlatTrees are both set");
+    // Flat trees are compiled, stree::Exec needs stree trees,
+    // other backends are not used in flat tree mode
+    if (flat_trees && config.get<unsigned>(conf::EvalMode) != EvalBytecode)
+        throw ConfigError("EvalMode is not bytecode in flat tree mode");
+    if (steady_state || flat_trees) {
+        const char* mode = steady_state ? "steady state" : "flat tree mode";
+        if (config.get<unsigned>(conf::TrailSampleSize) > 0)
+            throw ConfigError(std::string("TrailSampleSize is set in ") + mode);
+        if (config.get<unsigned>(conf::StepLimitInitial) > 0)
+            throw ConfigError(std::string("StepLimitInitial is set in ") + mode);
+        if (config.get<unsigned>(conf::IslandNum) > 1)
+            throw ConfigError(std::string("IslandNum is > 1 in ") + mode);
+    }
+
     config_percent_to_num(
         config,
         conf::CrossoverPercent, conf::CrossoverNum,
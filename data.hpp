@@ -1,8 +1,11 @@
 #ifndef ANTVIEW_DATA_HPP_
 #define ANTVIEW_DATA_HPP_
 
+#include <cstddef>
+#include <functional>
 #include <stdexcept>
 #include <string>
+#include <vector>
 #include <stree/stree.hpp>
 #include <streegp/streegp.hpp>
 #include "ant.hpp"
@@ -15,6 +18,33 @@ const char GenerationMax[]      = "generation_max";
 const char FitnessGoal[]        = "fitness_goal";
 const char ResultNum[]          = "result_num";
 const char StepLimit[]          = "step_limit";
+const char StepLimitInitial[]   = "step_limit_initial";
+const char Threads[]            = "threads";
+const char EvalMode[]           = "eval_mode";
+const char PruneEvaluation[]    = "prune_evaluation";
+const char FitnessCacheSize[]   = "fitness_cache_size";
+const char CheckpointInterval[] = "checkpoint_interval";
+const char TrailSampleSize[]    = "trail_sample_size";
+
+const char IslandNum[]          = "island_num";
+const char MigrationInterval[]  = "migration_interval";
+const char MigrationSize[]      = "migration_size";
+const char MigrationTopology[]  = "migration_topology";
+
+const char SteadyState[]               = "steady_state";
+const char EvaluationMax[]             = "evaluation_max";
+const char ReplacementTournamentSize[] = "replacement_tournament_size";
+
+const char FlatTrees[]          = "flat_trees";
+const char FlatMutationDepth[]  = "flat_mutation_depth";
+
+const char TreeSizeMax[]        = "tree_size_max";
+const char TreeDepthMax[]       = "tree_depth_max";
+const char Parsimony[]          = "parsimony";
+const char TarpeianRate[]       = "tarpeian_rate";
+// streegp's own key, also used by selection done here
+// (flat trees, lexicographic parsimony)
+const char SelectionTournamentSize[] = "selection.tournament_size";
 
 const char MutationNum[]        = "mutation_num";
 const char CrossoverNum[]       = "crossover_num";
@@ -32,6 +62,20 @@ const char ReproductionPercent[]    = "reproduction_percent";
 
 }
 
+enum EvalMode {
+    EvalBytecode, // compiled program
+    EvalExec,     // stree::Exec
+    EvalCheck,    // compiled program checked against stree::Exec
+    EvalJit,      // native code, compiled in batches
+    EvalLockstep  // compiled program run on all trails at once
+};
+
+enum Parsimony {
+    ParsimonyNone,
+    ParsimonyLexicographic, // smaller tree wins tournament on equal fitness
+    ParsimonyTarpeian       // some larger than average trees get worst fitness
+};
+
 class ConfigError : public std::invalid_argument {
 public:
     explicit ConfigError(const std::string& what);
@@ -40,8 +84,27 @@ public:
 stree::gp::Config make_default_config();
 stree::gp::Config load_config(const std::string& filename);
 
+// First trail in file, text or binary
 Trail load_trail(const std::string& filename);
 
+// Same, also get side of its world, see world_size(): world
+// stored in binary trail, smallest world containing text trail;
+// throws std::out_of_range if the trail doesn't fit any world
+Trail load_trail(const std::string& filename, Coord& size);
+
+// Call `fn(trail)' for each text trail in file, "-" is stdin,
+// or `binary_fn(trail)' for binary trail in place;
+// text input may hold any number of trails, they are parsed one
+// at a time; returns number of trails
+std::size_t read_trails(
+    const std::string& filename,
+    const std::function<void(Trail&)>& fn,
+    const std::function<void(const BinaryTrail&)>& binary_fn);
+
+// Trail files from comma separated list or directory,
+// "-" in the list is stdin
+std::vector<std::string> list_trail_files(const std::string& path);
+
 stree::Tree load_tree(stree::Environment& env, const std::string& filename);
 
 #endif
@@ -0,0 +1,611 @@
+#include "evaluator.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include "jit.hpp"
+#include "parallel.hpp"
+#include "primitives.hpp"
+
+template<typename A>
+static Fitness evaluate(
+    Individual& individual,
+    A& ant,
+    unsigned food_num,
+    unsigned step_limit);
+
+template<typename G>
+BasicEvaluator<G>::Case::Case(std::shared_ptr<const Grid> grid)
+    : grid(std::move(grid)),
+      distances(std::make_shared<const DistanceMap>(*this->grid)),
+      food_num(this->grid->count()),
+      ant(this->grid.get()),
+      pruner(distances.get(), food_num) {}
+
+template<typename G>
+BasicEvaluator<G>::BasicEvaluator(
+    const std::vector<Trail>& trails,
+    unsigned step_limit,
+    unsigned eval_mode)
+    : BasicEvaluator(step_limit, eval_mode)
+{
+    assert(trails.size() > 0);
+    cases.reserve(trails.size());
+    for (const Trail& trail : trails)
+        add_trail(trail);
+    select_trails({});
+}
+
+template<typename G>
+BasicEvaluator<G>::BasicEvaluator(unsigned step_limit, unsigned eval_mode)
+    : step_limit(step_limit),
+      eval_mode(eval_mode),
+      prune(false),
+      threshold(0.0),
+      checkpoint_interval(0),
+      cell_num(0),
+      full_num(0),
+      pruned_num(0),
+      cycle_num(0),
+      steps_saved(0),
+      resumed_num(0),
+      steps_skipped(0) {}
+
+template<typename G>
+void BasicEvaluator<G>::add_trail(const Trail& trail) {
+    add_case(std::make_shared<const Grid>(trail));
+}
+
+template<typename G>
+void BasicEvaluator<G>::add_trail(const Trail& trail, Coord size) {
+    add_case(std::make_shared<const Grid>(trail, size, size));
+}
+
+template<typename G>
+void BasicEvaluator<G>::add_trail(const BinaryTrail& trail) {
+    add_case(std::make_shared<const Grid>(trail));
+}
+
+template<typename G>
+void BasicEvaluator<G>::add_case(std::shared_ptr<const Grid> grid) {
+    cases.emplace_back(std::move(grid));
+    std::size_t case_cell_num = cases.back().grid->cell_num();
+    if (case_cell_num > cell_num) {
+        cell_num = case_cell_num;
+        detector = CycleDetector(cell_num);
+    }
+}
+
+template<typename G>
+Fitness BasicEvaluator<G>::operator()(Individual& individual) {
+    if (eval_mode == EvalExec) {
+        Fitness sum = 0.0;
+        for (unsigned index : selected) {
+            Case& fitness_case = cases[index];
+            ++full_num;
+            sum += evaluate(
+                individual, fitness_case.ant,
+                fitness_case.food_num, step_limit);
+        }
+        return sum / selected.size();
+    }
+
+    // Single programs are not worth native compilation,
+    // EvalJit falls back to bytecode here
+    return run(compile(individual));
+}
+
+template<typename G>
+Program BasicEvaluator<G>::compile(Individual& individual) {
+    Program program = compile_program(individual.tree());
+    check_compiled(individual, program);
+    return program;
+}
+
+template<typename G>
+void BasicEvaluator<G>::compile(Individual& individual, Program& program) {
+    compile_program(individual.tree(), program);
+    check_compiled(individual, program);
+}
+
+template<typename G>
+void BasicEvaluator<G>::check_compiled(
+    Individual& individual,
+    const Program& program)
+{
+    if (eval_mode != EvalCheck)
+        return;
+    for (unsigned index : selected) {
+        std::ostringstream ss;
+        const Grid& grid = *cases[index].grid;
+        if (!check_program(individual.tree(), program, grid, step_limit, ss)) {
+            std::cerr << "Compiled program check failed" << std::endl
+                      << individual.tree() << std::endl
+                      << ss.str();
+            std::exit(-1);
+        }
+    }
+}
+
+template<typename G>
+Fitness BasicEvaluator<G>::run(const Program& program) {
+    RunChecks checks;
+    checks.detector = &detector;
+    Fitness sum = 0.0;
+    for (unsigned index : selected) {
+        Case& fitness_case = cases[index];
+        fitness_case.ant.reset();
+        sum += complete(
+            fitness_case,
+            program.run(fitness_case.ant, step_limit, &checks));
+    }
+    return sum / selected.size();
+}
+
+template<typename G>
+Fitness BasicEvaluator<G>::complete(Case& fitness_case, RunStatus status) {
+    const Ant& ant = fitness_case.ant;
+    switch (status) {
+        case RunDone:
+            ++full_num;
+            break;
+        case RunCycle:
+            ++full_num;
+            ++cycle_num;
+            steps_saved += step_limit - ant.action_num();
+            break;
+        case RunPruned:
+            // Real fitness is not below threshold, pessimistic value
+            // keeps pruned individuals out of tournaments and results
+            ++pruned_num;
+            return WorstFitness;
+    }
+    return static_cast<float>(ant.food_left()) / fitness_case.food_num;
+}
+
+template<typename G>
+void BasicEvaluator<G>::set_threshold(Fitness threshold) {
+    prune = true;
+    this->threshold = threshold;
+}
+
+template<typename G>
+void BasicEvaluator<G>::clear_threshold() {
+    prune = false;
+}
+
+template<typename G>
+void BasicEvaluator<G>::select_trails(const std::vector<unsigned>& indices) {
+    selected = indices;
+    if (selected.empty()) {
+        for (unsigned i = 0; i < cases.size(); ++i)
+            selected.push_back(i);
+    }
+
+    if (eval_mode == EvalLockstep) {
+        if constexpr (HasLockstep) {
+            locksteps.clear();
+            for (std::size_t i = 0; i < selected.size(); i += Lockstep::MaxLanes) {
+                std::vector<const Grid*> grids;
+                for (std::size_t j = i; j < selected.size() && j < i + Lockstep::MaxLanes; ++j)
+                    grids.push_back(cases[selected[j]].grid.get());
+                locksteps.emplace_back(grids);
+            }
+        } else {
+            throw std::logic_error(
+                "Lockstep evaluation is not supported in sparse worlds");
+        }
+    }
+}
+
+template<typename G>
+void BasicEvaluator<G>::reserve_traces(std::vector<RunTrace>& traces) const {
+    assert(checkpoint_interval > 0);
+    traces.resize(cases.size());
+    // Checkpoint is saved every `checkpoint_interval' actions
+    // from the start, first UndoLogSize eaten cells are saved
+    std::size_t checkpoint_num = step_limit / checkpoint_interval + 1;
+    for (std::size_t i = 0; i < cases.size(); ++i) {
+        traces[i].reserve(
+            checkpoint_num,
+            std::min<std::size_t>(cases[i].food_num, AntBase::UndoLogSize));
+    }
+}
+
+template<typename G>
+void BasicEvaluator<G>::run_jobs(EvalJobList& jobs, std::size_t begin, std::size_t end) {
+    std::size_t num = selected.size();
+
+    if (eval_mode == EvalExec) {
+        for (std::size_t i = begin; i < end; ++i) {
+            jobs[i].fitness = (*this)(*jobs[i].individual);
+            jobs[i].exact = true;
+        }
+        return;
+    }
+
+    if constexpr (HasLockstep) {
+        if (eval_mode == EvalLockstep) {
+            // No pruning, each run covers many trails
+            for (std::size_t i = begin; i < end; ++i) {
+                Fitness sum = 0.0;
+                std::size_t k = 0;
+                for (Lockstep& lockstep : locksteps) {
+                    lockstep.run(jobs[i].slot->program, step_limit);
+                    for (unsigned lane = 0; lane < lockstep.lane_num(); ++lane, ++k) {
+                        ++full_num;
+                        if (lockstep.status(lane) == RunCycle) {
+                            ++cycle_num;
+                            steps_saved += step_limit - lockstep.action_num(lane);
+                        }
+                        sum += static_cast<float>(lockstep.food_left(lane))
+                            / cases[selected[k]].food_num;
+                    }
+                }
+                jobs[i].fitness = sum / num;
+                jobs[i].exact = true;
+            }
+            return;
+        }
+    }
+
+    // Compile whole range at once
+    BasicJitBatch<G> batch;
+    if (eval_mode == EvalJit) {
+        for (std::size_t i = begin; i < end; ++i)
+            batch.add(jobs[i].slot->program);
+        batch.finalize();
+    }
+
+    // Least fitness sum possible on trails after each selected trail,
+    // threshold left for a trail is threshold for the sum minus
+    // fitness on previous trails and this bound
+    std::vector<Fitness> rest_bounds(num, 0.0);
+    if (prune) {
+        for (std::size_t k = num - 1; k > 0; --k) {
+            Case& fitness_case = cases[selected[k]];
+            fitness_case.ant.reset();
+            rest_bounds[k - 1] = rest_bounds[k]
+                + static_cast<float>(
+                    fitness_case.pruner.food_left_bound(
+                        fitness_case.ant, step_limit))
+                / fitness_case.food_num;
+        }
+    }
+
+    std::vector<Fitness> sums(end - begin, 0.0);
+    for (std::size_t i = begin; i < end; ++i) {
+        jobs[i].exact = true;
+        if (is_traced()) {
+            std::vector<RunTrace>& traces = jobs[i].slot->traces;
+            reserve_traces(traces);
+            for (RunTrace& trace : traces)
+                trace.clear();
+        }
+    }
+
+    // Trail by trail, so that trail data stays in cache
+    for (std::size_t k = 0; k < num; ++k) {
+        unsigned index = selected[k];
+        Case& fitness_case = cases[index];
+        Ant& ant = fitness_case.ant;
+        RunChecks checks;
+        checks.detector = &detector;
+        if (prune)
+            checks.pruner = &fitness_case.pruner;
+
+        for (std::size_t i = begin; i < end; ++i) {
+            EvalJob& job = jobs[i];
+            const Program& program = job.slot->program;
+            if (!job.exact)
+                continue; // pruned on previous trail
+            Fitness& sum = sums[i - begin];
+            if (prune) {
+                fitness_case.pruner.set_threshold(
+                    threshold * num - sum - rest_bounds[k]);
+            }
+
+            ant.reset();
+            RunStatus status;
+            if (eval_mode == EvalJit) {
+                status = batch.run(i - begin, ant, step_limit, &checks);
+            } else if (!is_traced()) {
+                status = program.run(ant, step_limit, &checks);
+            } else if (job.parent
+                       && job.parent->traces.size() > index
+                       && !job.parent->traces[index].checkpoints.empty())
+            {
+                RunTrace& trace = job.slot->traces[index];
+                status = program.resume(
+                    ant, step_limit, &checks, checkpoint_interval,
+                    job.parent->program, job.parent->traces[index], trace);
+                if (trace.resumed > 0) {
+                    ++resumed_num;
+                    steps_skipped += trace.resumed;
+                }
+            } else {
+                status = program.run(
+                    ant, step_limit, &checks, checkpoint_interval,
+                    job.slot->traces[index]);
+            }
+
+            sum += complete(fitness_case, status);
+            if (status == RunPruned)
+                job.exact = false;
+        }
+    }
+
+    for (std::size_t i = begin; i < end; ++i) {
+        jobs[i].fitness = jobs[i].exact
+            ? sums[i - begin] / num
+            : WorstFitness;
+    }
+}
+
+template<typename G>
+void evaluate_population(
+    Population& population,
+    EvaluatorList<G>& evaluators,
+    FitnessCache& cache,
+    TraceList& traces,
+    const TraceList& parent_traces,
+    bool all)
+{
+    assert(evaluators.size() > 0);
+    assert(&traces != &parent_traces);
+    const std::size_t NoJob = -1;
+    bool traced = evaluators.front().is_traced();
+    traces.resize(population.size());
+
+    std::vector<Individual*> individuals;
+    std::vector<std::size_t> indices; // population indices
+    individuals.reserve(population.size());
+    indices.reserve(population.size());
+    for (std::size_t i = 0; i < population.size(); ++i) {
+        if (all || !population[i].has_fitness()) {
+            individuals.push_back(&population[i]);
+            indices.push_back(i);
+            traces[i].traced = false;
+        }
+    }
+
+    // Compile into slots, reusing their code buffers
+    auto program = [&](std::size_t i) -> Program& {
+        return traces[indices[i]].program;
+    };
+    parallel_for(
+        individuals.size(),
+        evaluators.size(),
+        [&](std::size_t begin, std::size_t end, unsigned thread_index) {
+            for (std::size_t i = begin; i < end; ++i)
+                evaluators[thread_index].compile(*individuals[i], program(i));
+        });
+
+    // Find first individual with the same program, individuals are
+    // sorted by hash, so there are no per-program allocations
+    std::vector<FitnessCache::Hash> hashes(individuals.size());
+    std::vector<std::size_t> order(individuals.size());
+    for (std::size_t i = 0; i < individuals.size(); ++i) {
+        hashes[i] = FitnessCache::hash(program(i));
+        order[i] = i;
+    }
+    std::sort(
+        order.begin(), order.end(),
+        [&hashes](std::size_t a, std::size_t b) {
+            return hashes[a] < hashes[b] || (hashes[a] == hashes[b] && a < b);
+        });
+    std::vector<std::size_t> firsts(individuals.size());
+    for (std::size_t begin = 0, end = 0; begin < order.size(); begin = end) {
+        end = begin + 1;
+        while (end < order.size() && hashes[order[end]] == hashes[order[begin]])
+            ++end;
+        for (std::size_t k = begin; k < end; ++k) {
+            std::size_t i = order[k];
+            firsts[i] = i;
+            for (std::size_t l = begin; l < k; ++l) {
+                std::size_t j = order[l];
+                if (firsts[j] == j && program(j).code() == program(i).code()) {
+                    firsts[i] = j;
+                    break;
+                }
+            }
+        }
+    }
+
+    // Look up in cache, collect distinct programs
+    EvalJobList jobs;
+    jobs.reserve(individuals.size());
+    std::vector<std::size_t> job_indices(individuals.size(), NoJob);
+    for (std::size_t i = 0; i < individuals.size(); ++i) {
+        FitnessCache::Hash hash = hashes[i];
+
+        Fitness fitness;
+        if (cache.find(hash, program(i), fitness)) {
+            ++cache.hit_num;
+            individuals[i]->set_fitness(fitness);
+            continue;
+        }
+
+        // Same program earlier in this generation
+        if (firsts[i] != i) {
+            ++cache.hit_num;
+            job_indices[i] = job_indices[firsts[i]];
+            continue;
+        }
+
+        ++cache.miss_num;
+        job_indices[i] = jobs.size();
+        TracedProgram& slot = traces[indices[i]];
+        jobs.emplace_back(individuals[i], &slot, hash);
+        if (traced && slot.parent < parent_traces.size()
+            && parent_traces[slot.parent].traced)
+        {
+            jobs.back().parent = &parent_traces[slot.parent];
+        }
+    }
+
+    // Run distinct programs
+    parallel_for(
+        jobs.size(),
+        evaluators.size(),
+        [&jobs, &evaluators](
+            std::size_t begin,
+            std::size_t end,
+            unsigned thread_index)
+        {
+            evaluators[thread_index].run_jobs(jobs, begin, end);
+        });
+
+    // Pruned run result depends on current threshold, don't cache it
+    for (const EvalJob& job : jobs) {
+        if (job.exact)
+            cache.insert(job.hash, job.slot->program, job.fitness);
+    }
+
+    for (std::size_t i = 0; i < individuals.size(); ++i) {
+        if (job_indices[i] != NoJob)
+            individuals[i]->set_fitness(jobs[job_indices[i]].fitness);
+    }
+
+    // Checkpoints for offspring: repeated programs copy them from
+    // the slot that ran, individuals found in cache or not evaluated
+    // keep parent checkpoints, resuming checks which ones are still
+    // valid; copies reuse slot buffers
+    if (traced) {
+        const BasicEvaluator<G>& evaluator = evaluators.front();
+        for (const EvalJob& job : jobs)
+            job.slot->traced = true;
+        for (std::size_t i = 0; i < individuals.size(); ++i) {
+            TracedProgram& slot = traces[indices[i]];
+            if (job_indices[i] != NoJob && !slot.traced) {
+                evaluator.reserve_traces(slot.traces);
+                slot.assign(*jobs[job_indices[i]].slot);
+            }
+        }
+        for (TracedProgram& slot : traces) {
+            if (!slot.traced && slot.parent < parent_traces.size()
+                && parent_traces[slot.parent].traced)
+            {
+                evaluator.reserve_traces(slot.traces);
+                slot.assign(parent_traces[slot.parent]);
+            }
+        }
+    }
+}
+
+template<typename G>
+Fitness evaluate_individual(
+    BasicEvaluator<G>& evaluator,
+    Individual& individual,
+    FitnessCache& cache,
+    std::mutex& cache_mutex)
+{
+    if (evaluator.eval_mode == EvalExec)
+        return evaluator(individual);
+    return evaluate_program(
+        evaluator, evaluator.compile(individual), cache, cache_mutex);
+}
+
+template<typename G>
+Fitness evaluate_program(
+    BasicEvaluator<G>& evaluator,
+    const Program& program,
+    FitnessCache& cache,
+    std::mutex& cache_mutex)
+{
+    FitnessCache::Hash hash = FitnessCache::hash(program);
+    Fitness fitness;
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        if (cache.find(hash, program, fitness)) {
+            ++cache.hit_num;
+            return fitness;
+        }
+        ++cache.miss_num;
+    }
+
+    // Pruned run result depends on threshold, don't cache it
+    unsigned long pruned_num = evaluator.pruned_num;
+    fitness = evaluator.run(program);
+    if (evaluator.pruned_num == pruned_num) {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        cache.insert(hash, program, fitness);
+    }
+    return fitness;
+}
+
+template<typename G>
+void print_eval_stats(EvaluatorList<G>& evaluators) {
+    unsigned long full_num = 0;
+    unsigned long pruned_num = 0;
+    unsigned long cycle_num = 0;
+    unsigned long steps_saved = 0;
+    unsigned long resumed_num = 0;
+    unsigned long steps_skipped = 0;
+    for (BasicEvaluator<G>& evaluator : evaluators) {
+        full_num += evaluator.full_num;
+        pruned_num += evaluator.pruned_num;
+        cycle_num += evaluator.cycle_num;
+        steps_saved += evaluator.steps_saved;
+        resumed_num += evaluator.resumed_num;
+        steps_skipped += evaluator.steps_skipped;
+        evaluator.full_num = 0;
+        evaluator.pruned_num = 0;
+        evaluator.cycle_num = 0;
+        evaluator.steps_saved = 0;
+        evaluator.resumed_num = 0;
+        evaluator.steps_skipped = 0;
+    }
+    std::cout << "Evaluations: full " << full_num
+              << ", pruned " << pruned_num
+              << std::endl;
+    std::cout << "Cycles detected: " << cycle_num
+              << ", steps saved: " << steps_saved
+              << std::endl;
+    if (evaluators.front().is_traced()) {
+        std::cout << "Resumed runs: " << resumed_num
+                  << ", steps skipped: " << steps_skipped
+                  << std::endl;
+    }
+}
+
+template<typename A>
+Fitness evaluate(
+    Individual& individual,
+    A& ant,
+    unsigned food_num,
+    unsigned step_limit)
+{
+    using namespace stree;
+
+    // Reset ant
+    ant.reset();
+    // Run program
+    Exec exec(
+        individual.tree(),
+        Exec::FlagRunLoop | Exec::FlagStopIfCostNotZero);
+    Params params;
+    exec.init(&params, static_cast<DataPtr>(&ant));
+    exec.set_cost_limit(step_limit);
+    try {
+        exec.run();
+    } catch (ExecCostLimitExceeded& e) {
+        // do nothing
+    }
+    return static_cast<float>(ant.food_left()) / food_num;
+}
+
+#define ANTVIEW_INSTANTIATE(World) \
+    template struct BasicEvaluator<World>; \
+    template void evaluate_population( \
+        Population&, EvaluatorList<World>&, FitnessCache&, \
+        TraceList&, const TraceList&, bool); \
+    template Fitness evaluate_individual( \
+        BasicEvaluator<World>&, Individual&, FitnessCache&, std::mutex&); \
+    template Fitness evaluate_program( \
+        BasicEvaluator<World>&, const Program&, FitnessCache&, std::mutex&); \
+    template void print_eval_stats(EvaluatorList<World>&);
+ANTVIEW_FOR_EACH_WORLD(ANTVIEW_INSTANTIATE)
+#undef ANTVIEW_INSTANTIATE
@@ -0,0 +1,216 @@
+#ifndef ANTVIEW_EVALUATOR_HPP_
+#define ANTVIEW_EVALUATOR_HPP_
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+#include <stree/stree.hpp>
+#include <streegp/streegp.hpp>
+#include "ant.hpp"
+#include "data.hpp"
+#include "fitness_cache.hpp"
+#include "grid.hpp"
+#include "lockstep.hpp"
+#include "program.hpp"
+#include "trail.hpp"
+
+using Individual = stree::gp::Individual;
+using Population = stree::gp::Population<Individual>;
+using Group = stree::gp::Group<Individual>;
+using Fitness = stree::gp::Fitness;
+
+// All food is left
+const Fitness WorstFitness = 1.0;
+
+// Compiled program of individual with checkpoints, offspring resumes
+// from them. Slots are kept by individual index and reused every
+// generation, buffers are allocated only while they grow.
+struct TracedProgram {
+    static const std::size_t NoParent = -1;
+
+    TracedProgram()
+        : traced(false),
+          parent(NoParent) {}
+
+    // Take program and checkpoints of `other', keep buffers
+    void assign(const TracedProgram& other) {
+        program = other.program;
+        traces = other.traces;
+        traced = true;
+    }
+
+    Program program;
+    std::vector<RunTrace> traces; // by trail index, no checkpoints if not run
+    bool traced; // program and traces belong to individual
+    std::size_t parent; // index in previous generation
+};
+
+// Traced programs by individual index in population
+using TraceList = std::vector<TracedProgram>;
+
+// Distinct program to run
+struct EvalJob {
+    EvalJob(Individual* individual, TracedProgram* slot, FitnessCache::Hash hash)
+        : individual(individual),
+          slot(slot),
+          hash(hash),
+          fitness(0.0),
+          exact(false),
+          parent(nullptr) {}
+
+    Individual* individual; // first individual with this program
+    TracedProgram* slot; // its program, checkpoints are saved here
+    FitnessCache::Hash hash;
+    Fitness fitness;
+    bool exact; // false if run was pruned
+    const TracedProgram* parent; // checkpoints to resume from
+};
+
+using EvalJobList = std::vector<EvalJob>;
+
+// Lockstep type in worlds without lockstep evaluation
+struct NoLockstep {};
+
+// Fitness is mean part of food left over selected trails,
+// trails are evaluated in world `G'
+template<typename G>
+struct BasicEvaluator {
+    using Ant = BasicAnt<G>;
+    using Grid = BasicGrid<G>;
+    // Sparse worlds are too large for lane masks by cell
+    static constexpr bool HasLockstep = !std::is_same<G, SparseWorld>::value;
+    using Lockstep = std::conditional_t<
+        HasLockstep, BasicLockstep<G>, NoLockstep>;
+
+    // Trail with its own ant
+    struct Case {
+        explicit Case(std::shared_ptr<const Grid> grid);
+
+        // Shared by copies, each copy resets its own ant
+        std::shared_ptr<const Grid> grid;
+        std::shared_ptr<const DistanceMap> distances;
+        unsigned food_num;
+        Ant ant;
+        Pruner pruner;
+    };
+
+    BasicEvaluator(
+        const std::vector<Trail>& trails,
+        unsigned step_limit,
+        unsigned eval_mode);
+
+    // Evaluator without trails, add them with add_trail()
+    BasicEvaluator(unsigned step_limit, unsigned eval_mode);
+
+    // Add trail, evaluator keeps only the grid: trail in smallest
+    // world containing it, in world of given side, or in world stored
+    // in binary trail; call select_trails() when done adding
+    void add_trail(const Trail& trail);
+    void add_trail(const Trail& trail, Coord size);
+    void add_trail(const BinaryTrail& trail);
+    void add_case(std::shared_ptr<const Grid> grid);
+
+    Fitness operator()(Individual& individual);
+
+    // Compile individual's tree, check the result in EvalCheck mode;
+    // second form reuses code buffer of `program'
+    Program compile(Individual& individual);
+    void compile(Individual& individual, Program& program);
+
+    // Check compiled program in EvalCheck mode
+    void check_compiled(Individual& individual, const Program& program);
+
+    // Size `traces' for all trails, make room for their checkpoints
+    // so that reused trace slots don't allocate
+    void reserve_traces(std::vector<RunTrace>& traces) const;
+
+    // Run jobs in [begin, end), trail by trail
+    void run_jobs(EvalJobList& jobs, std::size_t begin, std::size_t end);
+
+    // Run compiled program on selected trails
+    Fitness run(const Program& program);
+
+    // Update counters, return fitness on trail for run result,
+    // worst fitness for pruned run
+    Fitness complete(Case& fitness_case, RunStatus status);
+
+    // Prune runs that cannot get fitness below threshold
+    void set_threshold(Fitness threshold);
+    void clear_threshold();
+
+    // Evaluate on trails with given indices, on all trails if empty;
+    // throws std::logic_error in EvalLockstep mode without lockstep
+    void select_trails(const std::vector<unsigned>& indices);
+
+    // Save checkpoints, resume from parent checkpoints;
+    // not supported by Exec, JIT and lockstep
+    bool is_traced() const {
+        return checkpoint_interval > 0
+            && (eval_mode == EvalBytecode || eval_mode == EvalCheck);
+    }
+
+    std::vector<Case> cases;
+    std::vector<unsigned> selected; // indices of cases in use
+    std::vector<Lockstep> locksteps; // selected trails in EvalLockstep mode
+    unsigned step_limit;
+    unsigned eval_mode;
+    bool prune;
+    Fitness threshold;
+    unsigned checkpoint_interval;
+    std::size_t cell_num; // of largest grid
+    CycleDetector detector;
+
+    // Counters
+    unsigned long full_num;
+    unsigned long pruned_num;
+    unsigned long cycle_num;
+    unsigned long steps_saved;
+    unsigned long resumed_num;
+    unsigned long steps_skipped;
+};
+
+template<typename G>
+using EvaluatorList = std::vector<BasicEvaluator<G>>;
+
+using Evaluator = BasicEvaluator<World32>;
+
+// Evaluate individuals that have no fitness yet (all individuals if
+// `all' is set), programs found in cache or repeated in population
+// are run only once.
+// Programs are compiled into `traces' slots, evaluated individuals
+// resume from checkpoints of their parents in `parent_traces'; after
+// evaluation each traced slot holds checkpoints of its individual,
+// or of its parent if the program was not run.
+template<typename G>
+void evaluate_population(
+    Population& population,
+    EvaluatorList<G>& evaluators,
+    FitnessCache& cache,
+    TraceList& traces,
+    const TraceList& parent_traces,
+    bool all = false);
+
+// Evaluate single individual, e.g. in a worker thread;
+// `cache' is shared by threads and guarded by `cache_mutex'
+template<typename G>
+Fitness evaluate_individual(
+    BasicEvaluator<G>& evaluator,
+    Individual& individual,
+    FitnessCache& cache,
+    std::mutex& cache_mutex);
+
+// Same for compiled program
+template<typename G>
+Fitness evaluate_program(
+    BasicEvaluator<G>& evaluator,
+    const Program& program,
+    FitnessCache& cache,
+    std::mutex& cache_mutex);
+
+// Output and reset evaluator counters
+template<typename G>
+void print_eval_stats(EvaluatorList<G>& evaluators);
+
+#endif
@@ -1,42 +1,216 @@
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdio>
 #include <cstdlib>
 #include <iostream>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <random>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <vector>
 #include <stree/stree.hpp>
 #include <streegp/streegp.hpp>
+#include "alloc_stats.hpp"
 #include "ant.hpp"
+#include "bloat.hpp"
 #include "data.hpp"
+#include "evaluator.hpp"
+#include "fitness_cache.hpp"
+#include "flat_tree.hpp"
+#include "island.hpp"
+#include "jit.hpp"
+#include "parallel.hpp"
 #include "primitives.hpp"
 
-using Individual = stree::gp::Individual;
-using Population = stree::gp::Population<Individual>;
-using Group = stree::gp::Group<Individual>;
-using Fitness = stree::gp::Fitness;
+// Trails from files given on command line, a file may hold any number
+// of trails. Files are read once to check trails and once more to build
+// evaluator, so trails are not kept in memory; trails from stdin are
+// kept since it can be read only once.
+struct TrailInput {
+    std::vector<std::string> filenames;
+    std::vector<Trail> stdin_trails;
+    unsigned trail_num;
+    Coord world_size; // of smallest world that fits all trails
+};
 
 static void usage(const std::string& name);
-static Trail load_trail_or_exit(const std::string& filename);
+static TrailInput load_trail_input_or_exit(const std::string& path);
+
+// Call `fn(trail)' for each input trail, text trail as Trail,
+// binary trail as BinaryTrail
+template<typename F>
+static void for_each_trail_or_exit(const TrailInput& input, F&& fn);
+
+// Run evolution with trails in world `G'
+template<typename G>
+static int evolve(
+    stree::gp::Config& config,
+    const TrailInput& input,
+    unsigned sample_size);
+
+// Random subset of trail indices for generation, in ascending order
+static std::vector<unsigned> sample_trails(
+    unsigned trail_num,
+    unsigned sample_size,
+    unsigned prng_seed,
+    unsigned generation);
+
+// Sources of `num' best individuals to send to other islands
+static Island::Trees emigrants(Population& population, unsigned num);
+
+// Replace worst individuals with trees from other islands,
+// new individuals have no fitness and no trace
+static void immigrate(
+    stree::Environment& env,
+    const Island::Trees& trees,
+    Population& population,
+    TraceList& traces);
+
+// Step limit for evaluation.
+// Starts at `step_limit_initial' and grows with best fitness
+// up to `step_limit', fitness 0 gets full limit.
+struct StepBudget {
+    explicit StepBudget(const stree::gp::Config& config);
+
+    bool is_full() const {
+        return current == full;
+    }
+
+    // Return true if limit has changed
+    bool update(Fitness best_fitness);
+
+    unsigned full;
+    unsigned initial;
+    unsigned current;
+};
+
+// Offspring slot ranges in next population
+struct BreedPlan {
+    enum Op {
+        OpCrossover,
+        OpMutationSubtree,
+        OpMutationPoint,
+        OpMutationHoist,
+        OpReproduction
+    };
 
-static Fitness evaluate(Individual& individual, const Trail& trail, unsigned step_limit);
+    explicit BreedPlan(const stree::gp::Config& config);
 
-struct Evaluator {
-    Evaluator(Trail trail, unsigned step_limit)
-        : trail(std::move(trail)),
-          step_limit(step_limit) {}
+    Op op(std::size_t index) const;
 
-    Fitness operator()(Individual& individual);
+    std::size_t crossover_end;
+    std::size_t mutation_subtree_end;
+    std::size_t mutation_point_end;
+    std::size_t mutation_hoist_end;
+};
 
-    Trail trail;
-    unsigned step_limit;
+// Individual in flat tree mode
+struct FlatIndividual {
+    FlatTree tree;
+    Fitness fitness;
+    bool has_fitness;
 };
 
+using FlatPopulation = std::vector<FlatIndividual>;
+
+// Breed individual with parents from `select()', set `parent' to index
+// of the parent offspring is most similar to
+template<typename C, typename S>
+static Individual breed(
+    C& context,
+    Population& population,
+    BreedPlan::Op op,
+    S select,
+    std::size_t& parent);
+
+// Breed individual, replace it with parent copy if it's over limits,
+// set `size' to offspring tree size
+template<typename C>
+static Individual breed_limited(
+    C& context,
+    Population& population,
+    const std::vector<std::size_t>& sizes,
+    const BloatControl& bloat,
+    BreedPlan::Op op,
+    std::mt19937& prng,
+    std::size_t& parent,
+    std::size_t& size);
+
+// Breed next population, pass parent indices and tree sizes
+// to offspring.
+// `pop_next' and `traces_next' keep their storage from previous
+// generation, old individuals are released here; trace slots keep
+// their buffers for the next evaluation.
+// Runs in calling thread: all stree trees share one environment
+// and its node manager, which is not thread-safe. Flat trees
+// (`flat_trees') are bred in parallel.
+template<typename C>
+static void breed_population(
+    C& context,
+    std::mt19937& prng,
+    const BreedPlan& plan,
+    const BloatControl& bloat,
+    unsigned prng_seed,
+    unsigned generation,
+    Population& pop_current,
+    Population& pop_next,
+    TraceList& traces_next,
+    const std::vector<std::size_t>& sizes_current,
+    std::vector<std::size_t>& sizes_next);
+
+// Steady-state evolution: each thread breeds offspring from current
+// population, evaluates it and puts it in place of a tournament loser,
+// until evaluation budget is spent or goal is achieved
+template<typename G, typename C>
+static void evolve_steady_state(
+    const stree::gp::Config& config,
+    std::vector<C>& contexts,
+    std::vector<std::mt19937>& prngs,
+    const BreedPlan& plan,
+    const BloatControl& bloat,
+    unsigned prng_seed,
+    EvaluatorList<G>& evaluators,
+    FitnessCache& cache,
+    Population& population);
+
+// Generational evolution with flat trees instead of stree trees,
+// `initial' population is converted and released
+template<typename G>
+static void evolve_flat(
+    const stree::gp::Config& config,
+    std::vector<std::mt19937>& prngs,
+    const BreedPlan& plan,
+    const BloatControl& bloat,
+    unsigned prng_seed,
+    EvaluatorList<G>& evaluators,
+    FitnessCache& cache,
+    Population& initial);
+
+// Breed flat individual, parent copy if offspring is over limits
+static FlatIndividual breed_flat(
+    const FlatPopulation& population,
+    const std::vector<std::size_t>& sizes,
+    const BloatControl& bloat,
+    BreedPlan::Op op,
+    unsigned mutation_depth,
+    std::mt19937& prng);
+
+static std::vector<std::size_t> tree_sizes(const Population& population);
+
+// Output mean and max. tree size
+static void print_tree_sizes(const std::vector<std::size_t>& sizes);
+
+static void print_results(const Group& best);
+
 int main(int argc, char** argv) {
-    // Load trail
+    // Load trails
     if (argc < 2)
         usage(argv[0]);
-    Trail trail = load_trail_or_exit(argv[1]);
+    TrailInput input = load_trail_input_or_exit(argv[1]);
 
     // Load config
     auto config = (argc < 3)
@@ -71,34 +245,229 @@ int main(int argc, char** argv) {
               << config.get<unsigned>(conf::MutationHoistNum)
               << std::endl;
 
-    // Random engine
-    auto PrngSeed = config.get<unsigned>(conf::PrngSeed);
+    // Fallback to all hardware threads if number of threads is not set,
+    // islands share them
+    unsigned island_num = config.get<unsigned>(conf::IslandNum);
+    if (config.get<unsigned>(conf::Threads) == 0) {
+        config.set<unsigned>(
+            conf::Threads,
+            std::max(1u, thread_num_or_default(0) / island_num));
+    }
+    std::cout << "# of threads           = "
+              << config.get<unsigned>(conf::Threads)
+              << std::endl;
+    if (island_num > 1) {
+        std::cout << "# of islands           = "
+                  << island_num
+                  << std::endl;
+    }
+
+    // Evaluate each generation on random subset of trails
+    unsigned sample_size = config.get<unsigned>(conf::TrailSampleSize);
+    bool sampled = (sample_size > 0 && sample_size < input.trail_num);
+    std::cout << "# of trails            = "
+              << input.trail_num
+              << std::endl;
+    if (sampled) {
+        std::cout << "# of trails sampled    = "
+                  << sample_size
+                  << std::endl;
+    }
+
+    if (config.get<unsigned>(conf::EvalMode) == EvalJit
+        && !JitBatch::is_supported())
+    {
+        std::cerr << "JIT is not supported on this platform" << std::endl;
+        std::exit(-1);
+    }
+
+    // Smallest world that fits all trails
+    Coord size = input.world_size;
+    std::cout << "World size             = "
+              << size << "x" << size
+              << std::endl;
+    // Trails larger than 256x256 use sparse world
+    if (size > World256::Width
+        && config.get<unsigned>(conf::EvalMode) == EvalLockstep)
+    {
+        std::cerr << "Lockstep evaluation is not supported for worlds"
+                  << " larger than 256x256" << std::endl;
+        std::exit(-1);
+    }
+
+    return with_world(size, [&](auto world) {
+        return evolve<decltype(world)>(config, input, sample_size);
+    });
+}
+
+template<typename G>
+int evolve(
+    stree::gp::Config& config,
+    const TrailInput& input,
+    unsigned sample_size)
+{
+    // Fork islands, only main one writes output
+    Island island(
+        config.get<unsigned>(conf::IslandNum),
+        config.get<unsigned>(conf::MigrationTopology));
+    if (!island.is_main())
+        std::freopen("/dev/null", "w", stdout);
+    auto MigrationInterval = config.get<unsigned>(conf::MigrationInterval);
+    auto MigrationSize = config.get<unsigned>(conf::MigrationSize);
+
+    // Random engine, each island has its own seed
+    auto PrngSeed = config.get<unsigned>(conf::PrngSeed) + island.index();
     std::mt19937 prng(PrngSeed);
 
-    // Evaluator
-    Evaluator evaluator(trail, config.get<unsigned>(conf::StepLimit));
+    // Step limit
+    StepBudget budget(config);
+    if (!budget.is_full()) {
+        std::cout << "Initial step limit     = "
+                  << budget.current
+                  << std::endl;
+    }
+
+    // Evaluator, trails are read again straight into evaluator
+    BasicEvaluator<G> evaluator(
+        budget.current,
+        config.get<unsigned>(conf::EvalMode));
+    for_each_trail_or_exit(input, [&evaluator](const auto& trail) {
+        evaluator.add_trail(trail);
+    });
+    evaluator.select_trails({});
+    unsigned trail_num = evaluator.cases.size();
+    bool sampled = (sample_size > 0 && sample_size < trail_num);
+    evaluator.checkpoint_interval =
+        config.get<unsigned>(conf::CheckpointInterval);
+    // Evaluator copies for worker threads
+    EvaluatorList<G> evaluators(config.get<unsigned>(conf::Threads), evaluator);
 
     // Initialize environment
     stree::Environment env;
-    init_environment(env);
+    init_environment<BasicAnt<G>>(env);
 
     // initialize GP context
     auto context = stree::gp::make_context<Individual>(
         config, env, evaluator, prng);
 
+    // Breeding contexts for worker threads, each with its own PRNG
+    // reseeded for every offspring slot
+    std::vector<std::mt19937> prngs(config.get<unsigned>(conf::Threads));
+    std::vector<decltype(context)> contexts;
+    contexts.reserve(prngs.size());
+    for (std::size_t i = 0; i < prngs.size(); ++i) {
+        contexts.emplace_back(
+            stree::gp::make_context<Individual>(
+                config, env, evaluators[i], prngs[i]));
+    }
+    BreedPlan plan(config);
+
+    FitnessCache cache(config.get<unsigned>(conf::FitnessCacheSize));
+
     // Initialize population
     unsigned generation = 0;
     std::cout << "Generation 0" << std::endl;
     Population pop_current;
     stree::gp::ramped_half_and_half(context, pop_current);
+    BloatControl bloat(config);
+
+    if (config.get<unsigned>(conf::ShowNodeStats))
+        AllocStats::enable();
+
+    if (config.get<unsigned>(conf::SteadyState)) {
+        TraceList traces;
+        evaluate_population(pop_current, evaluators, cache, traces, TraceList());
+        evolve_steady_state(
+            config, contexts, prngs, plan, bloat, PrngSeed,
+            evaluators, cache, pop_current);
+        print_eval_stats(evaluators);
+        print_results(
+            stree::gp::reap<Individual>(
+                pop_current, config.get<unsigned>(conf::ResultNum), evaluator));
+        return 0;
+    }
+
+    if (config.get<unsigned>(conf::FlatTrees)) {
+        evolve_flat(
+            config, prngs, plan, bloat, PrngSeed,
+            evaluators, cache, pop_current);
+        return 0;
+    }
+
+    // Populations and their programs are double-buffered, slots are
+    // reused every generation; while a generation is evaluated,
+    // `traces_next' holds programs of its parents
+    Population pop_next;
+    TraceList traces;
+    TraceList traces_next;
+    // Tree sizes by individual index
+    std::vector<std::size_t> sizes = tree_sizes(pop_current);
+    std::vector<std::size_t> sizes_next;
 
     stree::NodeManagerStats node_stats;
+    AllocStats alloc_stats = AllocStats::get();
     bool done = false;
+    bool budget_changed = false;
     do {
         // Output stree stats
         if (config.get<unsigned>(conf::ShowNodeStats)) {
             node_stats.update(env.node_manager());
             std::cout << node_stats << std::endl;
+            AllocStats current = AllocStats::get();
+            std::cout << (current - alloc_stats) << std::endl;
+            alloc_stats = current;
+        }
+
+        // Select trails, fitness on other trails is not comparable
+        if (sampled) {
+            auto indices = sample_trails(
+                trail_num, sample_size, PrngSeed, generation);
+            std::cout << "Trails:";
+            for (unsigned index : indices)
+                std::cout << " " << index;
+            std::cout << std::endl;
+            for (auto& item : evaluators)
+                item.select_trails(indices);
+            cache.clear();
+        }
+
+        // Kill some of new large trees, everyone is evaluated
+        // if step limit or trails have changed
+        bool evaluate_all = budget_changed || sampled;
+        if (bloat.parsimony == ParsimonyTarpeian && !evaluate_all) {
+            double mean_size = 0.0;
+            for (std::size_t size : sizes)
+                mean_size += size;
+            mean_size /= sizes.size();
+            for (std::size_t i = 0; i < pop_current.size(); ++i) {
+                if (!pop_current[i].has_fitness()
+                    && bloat.is_killed(sizes[i], mean_size, prng))
+                {
+                    pop_current[i].set_fitness(WorstFitness);
+                }
+            }
+        }
+
+        // Evaluate new individuals
+        evaluate_population(
+            pop_current, evaluators, cache, traces, traces_next, evaluate_all);
+        print_eval_stats(evaluators);
+        print_tree_sizes(sizes);
+        budget_changed = false;
+
+        // Exchange best individuals with other islands
+        if (island.num() > 1 && generation > 0
+            && generation % MigrationInterval == 0)
+        {
+            island.send(emigrants(pop_current, MigrationSize));
+            Island::Trees trees = island.receive();
+            std::cout << "Immigrants: " << trees.size() << std::endl;
+            if (!trees.empty()) {
+                immigrate(env, trees, pop_current, traces);
+                sizes = tree_sizes(pop_current);
+                evaluate_population(
+                    pop_current, evaluators, cache, traces, traces_next);
+            }
         }
 
         // Reap results
@@ -107,14 +476,70 @@ int main(int argc, char** argv) {
         done = (generation == config.get<unsigned>(conf::GenerationMax))
             || stree::gp::is_goal_achieved<Individual>(
                 best, config.get<float>(conf::FitnessGoal), evaluator);
-        if (done) {
-            std::cout << "Best results" << std::endl;
-            for (auto item : best) {
-                Individual& individual = item.get();
-                std::cout << "[" << individual.fitness() << "] "
-                          << individual.tree()
+
+        // Main island competes with best results of other islands
+        if (done && island.num() > 1) {
+            if (!island.is_main()) {
+                if (!island.send_results(emigrants(pop_current, best.size()))) {
+                    std::cerr << "Island " << island.index()
+                              << ": cannot send results" << std::endl;
+                    return -1;
+                }
+                return 0;
+            }
+            Island::Trees trees = island.collect_results();
+            immigrate(env, trees, pop_current, traces);
+            sizes = tree_sizes(pop_current);
+            evaluate_population(
+                pop_current, evaluators, cache, traces, traces_next);
+            best = stree::gp::reap<Individual>(
+                pop_current, config.get<unsigned>(conf::ResultNum), evaluator);
+        }
+        // Prune evaluations that cannot get into current best results,
+        // threshold is useless when trails change
+        if (!done && !sampled && config.get<unsigned>(conf::PruneEvaluation)) {
+            Fitness threshold = 0.0;
+            for (auto item : best)
+                threshold = std::max(threshold, item.get().fitness());
+            for (auto& item : evaluators)
+                item.set_threshold(threshold);
+        }
+
+        // Grow step limit, cached fitness is no longer valid
+        if (!done) {
+            Fitness best_fitness = best.front().get().fitness();
+            for (auto item : best)
+                best_fitness = std::min(best_fitness, item.get().fitness());
+            if (budget.update(best_fitness)) {
+                std::cout << "Step limit raised to " << budget.current
                           << std::endl;
+                evaluator.step_limit = budget.current;
+                for (auto& item : evaluators)
+                    item.step_limit = budget.current;
+                cache.clear();
+                budget_changed = true;
             }
+        }
+
+        // Re-score results with full step limit on all trails,
+        // pruned individuals have worst fitness instead of real one
+        bool pruned = config.get<unsigned>(conf::PruneEvaluation);
+        if (done && (!budget.is_full() || sampled || pruned)) {
+            evaluator.step_limit = budget.full;
+            evaluator.select_trails({});
+            for (auto item : best)
+                item.get().set_fitness(evaluator(item.get()));
+            std::stable_sort(
+                best.begin(), best.end(),
+                [](const std::reference_wrapper<Individual>& a,
+                   const std::reference_wrapper<Individual>& b)
+                {
+                    return a.get().fitness() < b.get().fitness();
+                });
+        }
+
+        if (done) {
+            print_results(best);
         } else {
             assert(best.size() > 0);
             std::cout << "Best fitness: ";
@@ -124,51 +549,25 @@ int main(int argc, char** argv) {
             }
             std::cout << std::endl;
         }
+        std::cout << "Fitness cache: hits " << cache.hit_num
+                  << ", misses " << cache.miss_num
+                  << ", entries " << cache.entry_num()
+                  << std::endl;
+        cache.hit_num = 0;
+        cache.miss_num = 0;
 
         if (!done) {
             ++generation;
             std::cout << std::endl;
             std::cout << "Generation " << generation << std::endl;
-            Population pop_next;
-            unsigned index = 0, max_index = 0;
-
-            /// Crossover
-            max_index += config.get<unsigned>(conf::CrossoverNum);
-            for (; index < max_index; ++index) {
-                // Select parents
-                const auto& parent1 = stree::gp::selection_tournament(context, pop_current);
-                const auto& parent2 = stree::gp::selection_tournament(context, pop_current);
-                Individual child = stree::gp::crossover_random(context, parent1, parent2);
-
-                // Add child
-                pop_next.emplace_back(std::move(child));
-            }
-
-            /// Mutation
-            // Random subtree mutation
-            max_index += config.get<unsigned>(conf::MutationSubtreeNum);
-            for (; index < max_index; ++index) {
-                const auto& individual = stree::gp::selection_tournament(context, pop_current);
-                pop_next.emplace_back(stree::gp::mutate_subtree(context, individual));
-            }
-            // Point mutation
-            max_index += config.get<unsigned>(conf::MutationPointNum);
-            for (; index < max_index; ++index) {
-                Individual& individual = stree::gp::selection_tournament(context, pop_current);
-                pop_next.emplace_back(stree::gp::mutate_point(context, individual));
-            }
-            // Hoist mutation
-            max_index += config.get<unsigned>(conf::MutationHoistNum);
-            for (; index < max_index; ++index) {
-                const auto& individual = stree::gp::selection_tournament(context, pop_current);
-                pop_next.emplace_back(stree::gp::mutate_hoist(context, individual));
-            }
-
-            /// Reproduction
-            while (pop_next.size() < pop_current.size()) {
-                const auto& individual = stree::gp::selection_tournament(context, pop_current);
-                pop_next.emplace_back(individual.copy());
-            }
+            breed_population(
+                contexts.front(), prngs.front(), plan, bloat,
+                PrngSeed, generation,
+                pop_current, pop_next,
+                traces_next,
+                sizes, sizes_next);
+            traces.swap(traces_next);
+            sizes.swap(sizes_next);
 
             /// Swap populations
             pop_current.swap(pop_next);
@@ -179,46 +578,633 @@ int main(int argc, char** argv) {
 }
 
 
+template<typename G, typename C>
+void evolve_steady_state(
+    const stree::gp::Config& config,
+    std::vector<C>& contexts,
+    std::vector<std::mt19937>& prngs,
+    const BreedPlan& plan,
+    const BloatControl& bloat,
+    unsigned prng_seed,
+    EvaluatorList<G>& evaluators,
+    FitnessCache& cache,
+    Population& population)
+{
+    assert(contexts.size() == prngs.size());
+    std::size_t size = population.size();
+    unsigned long evaluation_max = config.get<unsigned>(conf::EvaluationMax);
+    if (evaluation_max == 0)
+        evaluation_max = size * config.get<unsigned>(conf::GenerationMax);
+    auto ReplacementTournamentSize =
+        config.get<unsigned>(conf::ReplacementTournamentSize);
+    auto FitnessGoal = config.get<float>(conf::FitnessGoal);
+
+    // Population and tree operations are guarded by one lock, trees
+    // share stree environment that is not known to be thread-safe;
+    // only runs of compiled programs are concurrent
+    std::mutex population_mutex;
+    std::mutex cache_mutex;
+    std::atomic<unsigned long> evaluation_num(0);
+    std::atomic<bool> done(false);
+    std::vector<std::size_t> sizes = tree_sizes(population);
+    std::size_t size_sum = 0;
+    for (std::size_t item : sizes)
+        size_sum += item;
+
+    // Order of evaluations depends on thread timing,
+    // so results are not reproducible anyway
+    for (std::size_t i = 0; i < prngs.size(); ++i) {
+        std::seed_seq seed{prng_seed, static_cast<unsigned>(i)};
+        prngs[i].seed(seed);
+    }
+
+    std::cout << "Evaluation budget: " << evaluation_max << std::endl;
+    parallel_for(
+        contexts.size(),
+        contexts.size(),
+        [&](std::size_t, std::size_t, unsigned thread_index) {
+            auto& context = contexts[thread_index];
+            auto& prng = prngs[thread_index];
+            auto& evaluator = evaluators[thread_index];
+            Program program; // code buffer reused by this thread
+            std::uniform_int_distribution<std::size_t> slot_dist(0, size - 1);
+            while (!done) {
+                unsigned long number = ++evaluation_num;
+                if (number > evaluation_max)
+                    break;
+
+                // Slot picks operation in same proportions
+                // as in generational mode
+                std::unique_lock<std::mutex> lock(population_mutex);
+                std::size_t parent = 0;
+                std::size_t offspring_size = 0;
+                Individual offspring = breed_limited(
+                    context, population, sizes, bloat,
+                    plan.op(slot_dist(prng)), prng,
+                    parent, offspring_size);
+                // Killed tree would only replace the loser
+                // with the worst fitness, drop it; it is released
+                // before the lock
+                double mean_size = static_cast<double>(size_sum) / size;
+                if (bloat.parsimony == ParsimonyTarpeian
+                    && bloat.is_killed(offspring_size, mean_size, prng))
+                {
+                    continue;
+                }
+                if (evaluator.eval_mode == EvalExec) {
+                    // stree::Exec runs the tree itself
+                    offspring.set_fitness(
+                        evaluate_individual(evaluator, offspring, cache, cache_mutex));
+                } else {
+                    evaluator.compile(offspring, program);
+                    lock.unlock();
+                    Fitness fitness = evaluate_program(
+                        evaluator, program, cache, cache_mutex);
+                    lock.lock();
+                    offspring.set_fitness(fitness);
+                }
+
+                std::size_t loser = tournament(
+                    sizes,
+                    [&population](std::size_t index) {
+                        return population[index].fitness();
+                    },
+                    bloat, ReplacementTournamentSize, true, prng);
+                if (offspring.fitness() <= FitnessGoal)
+                    done = true;
+                population[loser] = std::move(offspring);
+                size_sum = size_sum - sizes[loser] + offspring_size;
+                sizes[loser] = offspring_size;
+
+                // Report after each population size of evaluations
+                if (number % size == 0) {
+                    Fitness best = population.front().fitness();
+                    for (const Individual& individual : population)
+                        best = std::min(best, individual.fitness());
+                    std::cout << "Evaluations: " << number
+                              << ", best fitness: " << best
+                              << std::endl;
+                    print_tree_sizes(sizes);
+                }
+            }
+        },
+        1);
+
+    std::cout << "Fitness cache: hits " << cache.hit_num
+              << ", misses " << cache.miss_num
+              << ", entries " << cache.entry_num()
+              << std::endl;
+}
+
+template<typename G>
+void evolve_flat(
+    const stree::gp::Config& config,
+    std::vector<std::mt19937>& prngs,
+    const BreedPlan& plan,
+    const BloatControl& bloat,
+    unsigned prng_seed,
+    EvaluatorList<G>& evaluators,
+    FitnessCache& cache,
+    Population& initial)
+{
+    auto GenerationMax = config.get<unsigned>(conf::GenerationMax);
+    auto FitnessGoal = config.get<float>(conf::FitnessGoal);
+    auto ResultNum = config.get<unsigned>(conf::ResultNum);
+    auto FlatMutationDepth = config.get<unsigned>(conf::FlatMutationDepth);
+    bool show_stats = config.get<unsigned>(conf::ShowNodeStats);
+
+    FlatPopulation pop_current;
+    pop_current.reserve(initial.size());
+    for (const Individual& individual : initial)
+        pop_current.push_back({make_flat_tree(individual.tree()), 0.0, false});
+    Population().swap(initial);
+    std::size_t size = pop_current.size();
+    FlatPopulation pop_next(size);
+
+    std::mutex cache_mutex;
+    std::vector<std::size_t> sizes(size);
+    // Programs by slot, code buffers are reused every generation
+    std::vector<Program> programs(size);
+    AllocStats alloc_stats = AllocStats::get();
+    for (unsigned generation = 0; ; ++generation) {
+        std::size_t node_num = 0;
+        for (std::size_t i = 0; i < size; ++i) {
+            sizes[i] = pop_current[i].tree.size();
+            node_num += sizes[i];
+        }
+        if (show_stats) {
+            AllocStats current = AllocStats::get();
+            std::cout << "Flat tree nodes: " << node_num
+                      << ", bytes: " << node_num * sizeof(FlatTree::Node)
+                      << std::endl
+                      << (current - alloc_stats) << std::endl;
+            alloc_stats = current;
+        }
+
+        // Kill some of new large trees
+        if (bloat.parsimony == ParsimonyTarpeian) {
+            std::seed_seq seed{prng_seed, generation};
+            std::mt19937 prng(seed);
+            double mean_size = static_cast<double>(node_num) / size;
+            for (std::size_t i = 0; i < size; ++i) {
+                FlatIndividual& individual = pop_current[i];
+                if (!individual.has_fitness
+                    && bloat.is_killed(sizes[i], mean_size, prng))
+                {
+                    individual.fitness = WorstFitness;
+                    individual.has_fitness = true;
+                }
+            }
+        }
+
+        // Evaluate new individuals
+        parallel_for(
+            size,
+            evaluators.size(),
+            [&](std::size_t begin, std::size_t end, unsigned thread_index) {
+                for (std::size_t i = begin; i < end; ++i) {
+                    FlatIndividual& individual = pop_current[i];
+                    if (individual.has_fitness)
+                        continue;
+                    Program::compile(individual.tree, programs[i]);
+                    individual.fitness = evaluate_program(
+                        evaluators[thread_index], programs[i],
+                        cache, cache_mutex);
+                    individual.has_fitness = true;
+                }
+            });
+        print_eval_stats(evaluators);
+        print_tree_sizes(sizes);
+
+        // Best results
+        std::vector<std::size_t> indices(size);
+        for (std::size_t i = 0; i < size; ++i)
+            indices[i] = i;
+        std::size_t result_num = std::min<std::size_t>(ResultNum, size);
+        std::partial_sort(
+            indices.begin(), indices.begin() + result_num, indices.end(),
+            [&pop_current](std::size_t a, std::size_t b) {
+                return pop_current[a].fitness < pop_current[b].fitness;
+            });
+        indices.resize(result_num);
+        bool done = (generation == GenerationMax)
+            || pop_current[indices.front()].fitness <= FitnessGoal;
+
+        if (done) {
+            std::cout << "Best results" << std::endl;
+            for (std::size_t index : indices) {
+                const FlatIndividual& individual = pop_current[index];
+                std::cout << "[" << individual.fitness << "] "
+                          << individual.tree
+                          << std::endl;
+            }
+        } else {
+            std::cout << "Best fitness: ";
+            for (std::size_t index : indices)
+                std::cout << pop_current[index].fitness << " ";
+            std::cout << std::endl;
+        }
+        std::cout << "Fitness cache: hits " << cache.hit_num
+                  << ", misses " << cache.miss_num
+                  << ", entries " << cache.entry_num()
+                  << std::endl;
+        cache.hit_num = 0;
+        cache.miss_num = 0;
+        if (done)
+            break;
+
+        std::cout << std::endl;
+        std::cout << "Generation " << (generation + 1) << std::endl;
+
+        // Offspring goes straight to its slot
+        parallel_for(
+            size,
+            prngs.size(),
+            [&](std::size_t begin, std::size_t end, unsigned thread_index) {
+                auto& prng = prngs[thread_index];
+                for (std::size_t index = begin; index < end; ++index) {
+                    std::seed_seq seed{
+                        prng_seed,
+                        generation + 1,
+                        static_cast<unsigned>(index)};
+                    prng.seed(seed);
+                    pop_next[index] = breed_flat(
+                        pop_current, sizes, bloat, plan.op(index),
+                        FlatMutationDepth, prng);
+                }
+            });
+        pop_current.swap(pop_next);
+    }
+}
+
+FlatIndividual breed_flat(
+    const FlatPopulation& population,
+    const std::vector<std::size_t>& sizes,
+    const BloatControl& bloat,
+    BreedPlan::Op op,
+    unsigned mutation_depth,
+    std::mt19937& prng)
+{
+    auto select = [&]() -> const FlatIndividual& {
+        return population[tournament(
+            sizes,
+            [&population](std::size_t index) {
+                return population[index].fitness;
+            },
+            bloat, bloat.tournament_size, false, prng)];
+    };
+    const FlatIndividual& parent = select();
+    FlatTree tree;
+    switch (op) {
+        case BreedPlan::OpCrossover:
+            tree = FlatTree::crossover(parent.tree, select().tree, prng);
+            break;
+        case BreedPlan::OpMutationSubtree:
+            tree = parent.tree.mutate_subtree(prng, mutation_depth);
+            break;
+        case BreedPlan::OpMutationPoint:
+            tree = parent.tree.mutate_point(prng);
+            break;
+        case BreedPlan::OpMutationHoist:
+            tree = parent.tree.mutate_hoist(prng);
+            break;
+        case BreedPlan::OpReproduction:
+            // Trails don't change, fitness is still valid
+            return parent;
+    }
+    if (!bloat.fits(tree.size(), bloat.depth_max > 0 ? tree.depth() : 0))
+        return parent;
+    return {std::move(tree), 0.0, false};
+}
+
+std::vector<std::size_t> tree_sizes(const Population& population) {
+    std::vector<std::size_t> sizes(population.size());
+    for (std::size_t i = 0; i < population.size(); ++i)
+        sizes[i] = tree_shape(population[i].tree()).size;
+    return sizes;
+}
+
+void print_tree_sizes(const std::vector<std::size_t>& sizes) {
+    std::size_t sum = 0;
+    std::size_t max = 0;
+    for (std::size_t size : sizes) {
+        sum += size;
+        max = std::max(max, size);
+    }
+    std::cout << "Tree size: mean "
+              << (sizes.empty() ? 0.0 : static_cast<double>(sum) / sizes.size())
+              << ", max " << max
+              << std::endl;
+}
+
+void print_results(const Group& best) {
+    std::cout << "Best results" << std::endl;
+    for (auto item : best) {
+        Individual& individual = item.get();
+        std::cout << "[" << individual.fitness() << "] "
+                  << individual.tree()
+                  << std::endl;
+    }
+}
+
 void usage(const std::string& name) {
     using namespace std;
     cout << "Usage:" << endl
-         << name << " <trail-filename> [<config-filename>]" << endl;
+         << name << " <trail-filename>[,<trail-filename>...] [<config-filename>]"
+         << endl
+         << "    trail file may hold many trails, `-' is stdin" << endl
+         << name << " <trail-directory> [<config-filename>]" << endl;
     exit(-1);
 }
 
-Trail load_trail_or_exit(const std::string& filename) {
+TrailInput load_trail_input_or_exit(const std::string& path) {
+    TrailInput input;
+    input.trail_num = 0;
+    input.world_size = 0;
     try {
-        Trail trail = load_trail(filename);
-        if (trail.size() == 0)
-            throw std::invalid_argument("Trail is empty");
-        return trail;
+        input.filenames = list_trail_files(path);
     } catch (std::exception& e) {
         std::cerr << e.what() << std::endl;
         std::exit(-1);
     }
-    assert(false);
+    for (const std::string& filename : input.filenames) {
+        bool is_stdin = (filename == "-");
+        try {
+            auto check_size = [&](std::size_t size) {
+                if (size == 0)
+                    throw std::invalid_argument(
+                        "Trail " + std::to_string(input.trail_num) + " is empty");
+                ++input.trail_num;
+            };
+            auto check = [&](Trail& trail) {
+                check_size(trail.size());
+                // check if trail fits a world
+                input.world_size = std::max(input.world_size, world_size(trail));
+                if (is_stdin)
+                    input.stdin_trails.push_back(std::move(trail));
+            };
+            auto check_binary = [&](const BinaryTrail& trail) {
+                check_size(trail.size());
+                input.world_size = std::max(
+                    input.world_size, world_size(trail.width(), trail.height()));
+            };
+            if (read_trails(filename, check, check_binary) == 0)
+                throw std::invalid_argument("No trails");
+        } catch (std::exception& e) {
+            std::cerr << filename << ": " << e.what() << std::endl;
+            std::exit(-1);
+        }
+    }
+    return input;
 }
 
-Fitness evaluate(Individual& individual, const Trail& trail, unsigned step_limit) {
-    using namespace stree;
+template<typename F>
+void for_each_trail_or_exit(const TrailInput& input, F&& fn) {
+    for (const std::string& filename : input.filenames) {
+        if (filename == "-") {
+            for (const Trail& trail : input.stdin_trails)
+                fn(trail);
+            continue;
+        }
+        try {
+            read_trails(filename, fn, fn);
+        } catch (std::exception& e) {
+            std::cerr << filename << ": " << e.what() << std::endl;
+            std::exit(-1);
+        }
+    }
+}
 
-    // Make ant
-    Ant ant(trail);
-    // Run program
-    Exec exec(
-        individual.tree(),
-        Exec::FlagRunLoop | Exec::FlagStopIfCostNotZero);
-    Params params;
-    exec.init(&params, static_cast<DataPtr>(&ant));
-    exec.set_cost_limit(600);
-    try {
-        exec.run();
-    } catch (ExecCostLimitExceeded& e) {
-        // do nothing
+std::vector<unsigned> sample_trails(
+    unsigned trail_num,
+    unsigned sample_size,
+    unsigned prng_seed,
+    unsigned generation)
+{
+    assert(sample_size <= trail_num);
+    std::seed_seq seed{prng_seed, generation};
+    std::mt19937 prng(seed);
+
+    // Partial Fisher-Yates shuffle
+    std::vector<unsigned> indices(trail_num);
+    for (unsigned i = 0; i < trail_num; ++i)
+        indices[i] = i;
+    for (unsigned i = 0; i < sample_size; ++i) {
+        std::uniform_int_distribution<unsigned> dist(i, trail_num - 1);
+        std::swap(indices[i], indices[dist(prng)]);
     }
-    return static_cast<float>(ant.food_left()) / trail.size();
+    indices.resize(sample_size);
+    std::sort(indices.begin(), indices.end());
+    return indices;
+}
+
+// Population indices, best first
+static std::vector<std::size_t> rank_population(const Population& population) {
+    std::vector<std::size_t> indices(population.size());
+    for (std::size_t i = 0; i < indices.size(); ++i)
+        indices[i] = i;
+    std::stable_sort(
+        indices.begin(), indices.end(),
+        [&population](std::size_t a, std::size_t b) {
+            return population[a].fitness() < population[b].fitness();
+        });
+    return indices;
+}
+
+Island::Trees emigrants(Population& population, unsigned num) {
+    std::vector<std::size_t> indices = rank_population(population);
+    indices.resize(std::min<std::size_t>(num, indices.size()));
+    Island::Trees trees;
+    for (std::size_t index : indices) {
+        std::ostringstream os;
+        os << population[index].tree();
+        trees.push_back(os.str());
+    }
+    return trees;
+}
+
+void immigrate(
+    stree::Environment& env,
+    const Island::Trees& trees,
+    Population& population,
+    TraceList& traces)
+{
+    std::vector<std::size_t> indices = rank_population(population);
+    for (const std::string& source : trees) {
+        if (indices.empty())
+            break;
+        std::istringstream is(source);
+        stree::Parser parser(&env);
+        parser.parse(is);
+        if (!parser.is_done())
+            continue; // broken message, drop
+        // Replace worst
+        std::size_t index = indices.back();
+        indices.pop_back();
+        population[index] = Individual(stree::Tree(&env, parser.move_result()));
+        if (index < traces.size()) {
+            traces[index].traced = false;
+            traces[index].parent = TracedProgram::NoParent;
+        }
+    }
+}
+
+StepBudget::StepBudget(const stree::gp::Config& config)
+    : full(config.get<unsigned>(conf::StepLimit)),
+      initial(config.get<unsigned>(conf::StepLimitInitial)),
+      current(full)
+{
+    if (initial > 0)
+        current = initial;
 }
 
-Fitness Evaluator::operator()(Individual& individual) {
-    return evaluate(individual, trail, step_limit);
+bool StepBudget::update(Fitness best_fitness) {
+    if (is_full())
+        return false;
+    // Fitness is part of food left
+    float eaten = 1.0 - std::min(std::max(best_fitness, 0.0f), 1.0f);
+    unsigned limit = initial + static_cast<unsigned>((full - initial) * eaten);
+    if (limit <= current)
+        return false;
+    current = std::min(limit, full);
+    return true;
+}
+
+BreedPlan::BreedPlan(const stree::gp::Config& config) {
+    crossover_end = config.get<unsigned>(conf::CrossoverNum);
+    mutation_subtree_end = crossover_end
+        + config.get<unsigned>(conf::MutationSubtreeNum);
+    mutation_point_end = mutation_subtree_end
+        + config.get<unsigned>(conf::MutationPointNum);
+    mutation_hoist_end = mutation_point_end
+        + config.get<unsigned>(conf::MutationHoistNum);
+}
+
+BreedPlan::Op BreedPlan::op(std::size_t index) const {
+    if (index < crossover_end)
+        return OpCrossover;
+    if (index < mutation_subtree_end)
+        return OpMutationSubtree;
+    if (index < mutation_point_end)
+        return OpMutationPoint;
+    if (index < mutation_hoist_end)
+        return OpMutationHoist;
+    return OpReproduction;
+}
+
+template<typename C, typename S>
+Individual breed(
+    C& context,
+    Population& population,
+    BreedPlan::Op op,
+    S select,
+    std::size_t& parent)
+{
+    using namespace stree::gp;
+    auto index = [&population](const Individual& individual) {
+        return static_cast<std::size_t>(&individual - &population[0]);
+    };
+    switch (op) {
+        case BreedPlan::OpCrossover: {
+            // Offspring is first parent with subtree from second one
+            const auto& parent1 = select();
+            const auto& parent2 = select();
+            parent = index(parent1);
+            return crossover_random(context, parent1, parent2);
+        }
+        case BreedPlan::OpMutationSubtree: {
+            const auto& individual = select();
+            parent = index(individual);
+            return mutate_subtree(context, individual);
+        }
+        case BreedPlan::OpMutationPoint: {
+            Individual& individual = select();
+            parent = index(individual);
+            return mutate_point(context, individual);
+        }
+        case BreedPlan::OpMutationHoist: {
+            const auto& individual = select();
+            parent = index(individual);
+            return mutate_hoist(context, individual);
+        }
+        case BreedPlan::OpReproduction: {
+            const auto& individual = select();
+            parent = index(individual);
+            return individual.copy();
+        }
+    }
+    assert(false);
+}
+
+template<typename C>
+Individual breed_limited(
+    C& context,
+    Population& population,
+    const std::vector<std::size_t>& sizes,
+    const BloatControl& bloat,
+    BreedPlan::Op op,
+    std::mt19937& prng,
+    std::size_t& parent,
+    std::size_t& size)
+{
+    auto select = [&]() -> Individual& {
+        if (bloat.parsimony != ParsimonyLexicographic)
+            return stree::gp::selection_tournament(context, population);
+        return population[tournament(
+            sizes,
+            [&population](std::size_t index) {
+                return population[index].fitness();
+            },
+            bloat, bloat.tournament_size, false, prng)];
+    };
+    Individual offspring = breed(context, population, op, select, parent);
+    if (op != BreedPlan::OpReproduction) {
+        TreeShape shape = tree_shape(offspring.tree());
+        if (bloat.fits(shape.size, shape.depth)) {
+            size = shape.size;
+            return offspring;
+        }
+        // Over limits, keep parent
+        offspring = population[parent].copy();
+    }
+    size = sizes[parent];
+    return offspring;
+}
+
+template<typename C>
+void breed_population(
+    C& context,
+    std::mt19937& prng,
+    const BreedPlan& plan,
+    const BloatControl& bloat,
+    unsigned prng_seed,
+    unsigned generation,
+    Population& pop_current,
+    Population& pop_next,
+    TraceList& traces_next,
+    const std::vector<std::size_t>& sizes_current,
+    std::vector<std::size_t>& sizes_next)
+{
+    // Release previous generation
+    pop_next.clear();
+
+    std::size_t size = pop_current.size();
+    pop_next.reserve(size);
+    traces_next.resize(size);
+    sizes_next.assign(size, 0);
+    for (std::size_t index = 0; index < size; ++index) {
+        // PRNG stream depends only on seed, generation and slot,
+        // same as in flat tree mode
+        std::seed_seq seed{
+            prng_seed,
+            generation,
+            static_cast<unsigned>(index)};
+        prng.seed(seed);
+        std::size_t parent = 0;
+        pop_next.emplace_back(breed_limited(
+            context, pop_current, sizes_current, bloat,
+            plan.op(index), prng, parent, sizes_next[index]));
+        traces_next[index].traced = false;
+        traces_next[index].parent = parent;
+    }
 }
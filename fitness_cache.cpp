@@ -0,0 +1,52 @@
+#include "fitness_cache.hpp"
+
+FitnessCache::Hash FitnessCache::hash(const Program& program) {
+    // FNV-1a
+    Hash hash = 14695981039346656037ull;
+    auto add = [&hash](std::uint8_t byte) {
+        hash ^= byte;
+        hash *= 1099511628211ull;
+    };
+    for (const Program::Instr& instr : program.code()) {
+        add(instr.op);
+        add(instr.arg & 0xff);
+        add(instr.arg >> 8);
+    }
+    return hash;
+}
+
+FitnessCache::FitnessCache(std::size_t size)
+    : hit_num(0),
+      miss_num(0),
+      slots_(size),
+      entry_num_(0) {}
+
+bool FitnessCache::find(Hash hash, const Program& program, float& fitness) const {
+    if (slots_.empty())
+        return false;
+    const Slot& slot = slots_[hash % slots_.size()];
+    if (slot.used && slot.hash == hash && slot.code == program.code()) {
+        fitness = slot.fitness;
+        return true;
+    }
+    return false;
+}
+
+void FitnessCache::insert(Hash hash, const Program& program, float fitness) {
+    if (slots_.empty())
+        return;
+    Slot& slot = slots_[hash % slots_.size()];
+    if (!slot.used) {
+        slot.used = true;
+        ++entry_num_;
+    }
+    slot.hash = hash;
+    slot.fitness = fitness;
+    slot.code = program.code();
+}
+
+void FitnessCache::clear() {
+    for (Slot& slot : slots_)
+        slot = Slot();
+    entry_num_ = 0;
+}
@@ -0,0 +1,58 @@
+#ifndef ANTVIEW_FITNESS_CACHE_HPP_
+#define ANTVIEW_FITNESS_CACHE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "program.hpp"
+
+// Fitness of compiled programs.
+// Compiled code is a canonical form of a tree: trees that compile to
+// the same code get the same fitness. Entries are kept in a fixed
+// number of slots indexed by code hash, a new entry replaces the old
+// one in its slot. Stored code is compared on lookup, so hash
+// collisions cannot return wrong values.
+class FitnessCache {
+public:
+    using Hash = std::uint64_t;
+
+    static Hash hash(const Program& program);
+
+    // Zero size disables cache
+    explicit FitnessCache(std::size_t size);
+
+    bool find(Hash hash, const Program& program, float& fitness) const;
+    void insert(Hash hash, const Program& program, float fitness);
+    void clear();
+
+    std::size_t size() const {
+        return slots_.size();
+    }
+
+    // Number of used slots
+    std::size_t entry_num() const {
+        return entry_num_;
+    }
+
+    // Counters
+    unsigned long hit_num;
+    unsigned long miss_num;
+
+private:
+    struct Slot {
+        Slot()
+            : used(false),
+              hash(0),
+              fitness(0.0) {}
+
+        bool used;
+        Hash hash;
+        float fitness;
+        Program::Code code;
+    };
+
+    std::vector<Slot> slots_;
+    std::size_t entry_num_;
+};
+
+#endif
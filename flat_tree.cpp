@@ -0,0 +1,343 @@
+#include "flat_tree.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+const char Space[] = " \t\r\n";
+
+// Recursive descent parser, appends nodes in prefix order
+class Parser {
+public:
+    Parser(const std::string& source, FlatTree::Nodes& nodes)
+        : source_(source),
+          nodes_(nodes),
+          pos_(0) {}
+
+    void parse();
+
+private:
+    void node();
+
+    std::string symbol();
+    void skip_space();
+    bool is_end() const;
+    char peek() const;
+    void expect(char c);
+
+    [[noreturn]] void error(const std::string& message) const;
+
+    const std::string& source_;
+    FlatTree::Nodes& nodes_;
+    std::size_t pos_;
+};
+
+}
+
+static void random_node(
+    std::mt19937& prng,
+    unsigned depth,
+    bool full,
+    FlatTree::Nodes& nodes);
+
+static void print_node(
+    std::ostream& os,
+    const FlatTree::Nodes& nodes,
+    std::size_t& index);
+
+FlatTreeError::FlatTreeError(const std::string& what)
+    : std::invalid_argument(
+        std::string("Flat tree error: ") + what) {}
+
+unsigned FlatTree::arity(Op op) {
+    switch (op) {
+        case OpIfFoodAhead: return 2;
+        case OpProgn2: return 2;
+        case OpProgn3: return 3;
+        default: return 0;
+    }
+}
+
+const char* FlatTree::name(Op op) {
+    switch (op) {
+        case OpForward: return "forward";
+        case OpLeft: return "left";
+        case OpRight: return "right";
+        case OpIfFoodAhead: return "if-food-ahead";
+        case OpProgn2: return "progn2";
+        case OpProgn3: return "progn3";
+        default: assert(false);
+    }
+    return "";
+}
+
+FlatTree::Op FlatTree::op(const std::string& name) {
+    for (unsigned i = 0; i < OpNum; ++i) {
+        if (name == FlatTree::name(static_cast<Op>(i)))
+            return static_cast<Op>(i);
+    }
+    return OpNum;
+}
+
+FlatTree FlatTree::parse(const std::string& source) {
+    FlatTree tree;
+    Parser(source, tree.nodes_).parse();
+    return tree;
+}
+
+FlatTree FlatTree::from_ops(const std::vector<Op>& ops) {
+    if (ops.empty())
+        throw FlatTreeError("empty tree");
+    if (ops.size() > MaxSize)
+        throw FlatTreeError("tree is too large");
+    FlatTree tree;
+    Nodes& nodes = tree.nodes_;
+    nodes.reserve(ops.size());
+    for (Op op : ops)
+        nodes.push_back({op, 1});
+    // Children follow their parent, so going backwards their subtree
+    // sizes are already known
+    for (std::size_t i = nodes.size(); i-- > 0; ) {
+        std::size_t end = i + 1;
+        for (unsigned j = 0; j < arity(nodes[i].op); ++j) {
+            if (end == nodes.size())
+                throw FlatTreeError("missing arguments");
+            end += nodes[end].size;
+        }
+        nodes[i].size = end - i;
+    }
+    if (nodes[0].size != nodes.size())
+        throw FlatTreeError("unexpected nodes after tree end");
+    return tree;
+}
+
+FlatTree FlatTree::random(std::mt19937& prng, unsigned depth, bool full) {
+    FlatTree tree;
+    random_node(prng, depth, full, tree.nodes_);
+    return tree;
+}
+
+FlatTree FlatTree::crossover(
+    const FlatTree& a,
+    const FlatTree& b,
+    std::mt19937& prng)
+{
+    std::size_t index = a.random_index(prng);
+    return a.replace(index, b, b.random_index(prng));
+}
+
+FlatTree FlatTree::mutate_subtree(std::mt19937& prng, unsigned depth) const {
+    FlatTree subtree = random(prng, depth, false);
+    return replace(random_index(prng), subtree, 0);
+}
+
+FlatTree FlatTree::mutate_point(std::mt19937& prng) const {
+    FlatTree result(*this);
+    Node& node = result.nodes_[random_index(prng)];
+    // Other primitives of the same arity
+    Op ops[OpNum];
+    unsigned num = 0;
+    for (unsigned i = 0; i < OpNum; ++i) {
+        Op op = static_cast<Op>(i);
+        if (op != node.op && arity(op) == arity(node.op))
+            ops[num++] = op;
+    }
+    if (num > 0) {
+        std::uniform_int_distribution<unsigned> dist(0, num - 1);
+        node.op = ops[dist(prng)];
+    }
+    return result;
+}
+
+FlatTree FlatTree::mutate_hoist(std::mt19937& prng) const {
+    return subtree(random_index(prng));
+}
+
+FlatTree FlatTree::subtree(std::size_t index) const {
+    assert(index < nodes_.size());
+    FlatTree result;
+    auto begin = nodes_.begin() + index;
+    result.nodes_.assign(begin, begin + nodes_[index].size);
+    return result;
+}
+
+FlatTree FlatTree::replace(
+    std::size_t index,
+    const FlatTree& other,
+    std::size_t other_index) const
+{
+    assert(index < nodes_.size());
+    assert(other_index < other.nodes_.size());
+    std::size_t removed = nodes_[index].size;
+    std::size_t inserted = other.nodes_[other_index].size;
+    if (nodes_.size() - removed + inserted > MaxSize)
+        return *this;
+
+    FlatTree result;
+    result.nodes_.reserve(nodes_.size() - removed + inserted);
+    result.nodes_.insert(
+        result.nodes_.end(),
+        nodes_.begin(), nodes_.begin() + index);
+    result.nodes_.insert(
+        result.nodes_.end(),
+        other.nodes_.begin() + other_index,
+        other.nodes_.begin() + other_index + inserted);
+    result.nodes_.insert(
+        result.nodes_.end(),
+        nodes_.begin() + index + removed, nodes_.end());
+
+    // Resize ancestors, going down from the root and skipping
+    // sibling subtrees that end before `index'
+    std::size_t ancestor = 0;
+    while (ancestor < index) {
+        Node& node = result.nodes_[ancestor];
+        node.size = node.size + inserted - removed;
+        std::size_t child = ancestor + 1;
+        while (child + nodes_[child].size <= index)
+            child += nodes_[child].size;
+        ancestor = child;
+    }
+    return result;
+}
+
+unsigned FlatTree::depth() const {
+    // Children left to visit at each level
+    std::vector<unsigned> pending;
+    unsigned max_depth = 0;
+    for (const Node& node : nodes_) {
+        max_depth = std::max<unsigned>(max_depth, pending.size());
+        if (!pending.empty())
+            --pending.back();
+        if (arity(node.op) > 0)
+            pending.push_back(arity(node.op));
+        while (!pending.empty() && pending.back() == 0)
+            pending.pop_back();
+    }
+    return max_depth;
+}
+
+bool FlatTree::operator==(const FlatTree& other) const {
+    return std::equal(
+        nodes_.begin(), nodes_.end(),
+        other.nodes_.begin(), other.nodes_.end(),
+        [](const Node& a, const Node& b) {
+            return a.op == b.op && a.size == b.size;
+        });
+}
+
+std::size_t FlatTree::random_index(std::mt19937& prng) const {
+    assert(!nodes_.empty());
+    std::uniform_int_distribution<std::size_t> dist(0, nodes_.size() - 1);
+    return dist(prng);
+}
+
+std::ostream& operator<<(std::ostream& os, const FlatTree& tree) {
+    std::size_t index = 0;
+    if (!tree.empty())
+        print_node(os, tree.nodes(), index);
+    return os;
+}
+
+void random_node(
+    std::mt19937& prng,
+    unsigned depth,
+    bool full,
+    FlatTree::Nodes& nodes)
+{
+    // Terminals at max. depth, functions only in full tree,
+    // any primitive otherwise
+    std::uniform_int_distribution<unsigned> dist(
+        (depth > 0 && full) ? FlatTree::OpIfFoodAhead : FlatTree::OpForward,
+        (depth > 0) ? FlatTree::OpNum - 1 : FlatTree::OpRight);
+    auto op = static_cast<FlatTree::Op>(dist(prng));
+    std::size_t index = nodes.size();
+    nodes.push_back({op, 1});
+    for (unsigned i = 0; i < FlatTree::arity(op); ++i)
+        random_node(prng, depth - 1, full, nodes);
+    nodes[index].size = nodes.size() - index;
+}
+
+void print_node(
+    std::ostream& os,
+    const FlatTree::Nodes& nodes,
+    std::size_t& index)
+{
+    FlatTree::Op op = nodes[index++].op;
+    os << '(' << FlatTree::name(op);
+    for (unsigned i = 0; i < FlatTree::arity(op); ++i) {
+        os << ' ';
+        print_node(os, nodes, index);
+    }
+    os << ')';
+}
+
+void Parser::parse() {
+    node();
+    skip_space();
+    if (!is_end())
+        error("unexpected input after tree end");
+}
+
+void Parser::node() {
+    skip_space();
+    bool paren = (peek() == '(');
+    if (paren)
+        ++pos_;
+    std::string name = symbol();
+
+    FlatTree::Op op = FlatTree::op(name);
+    if (op == FlatTree::OpNum)
+        error("unknown symbol `" + name + "'");
+    if (!paren && FlatTree::arity(op) > 0)
+        error("missing arguments for `" + name + "'");
+    if (nodes_.size() >= FlatTree::MaxSize)
+        error("tree is too large");
+
+    std::size_t index = nodes_.size();
+    nodes_.push_back({op, 1});
+    for (unsigned i = 0; i < FlatTree::arity(op); ++i)
+        node();
+    nodes_[index].size = nodes_.size() - index;
+
+    if (paren) {
+        skip_space();
+        expect(')');
+    }
+}
+
+std::string Parser::symbol() {
+    std::size_t begin = pos_;
+    while (!is_end() && peek() != '(' && peek() != ')'
+           && !std::strchr(Space, peek()))
+    {
+        ++pos_;
+    }
+    if (pos_ == begin)
+        error("symbol expected");
+    return source_.substr(begin, pos_ - begin);
+}
+
+void Parser::skip_space() {
+    while (!is_end() && std::strchr(Space, peek()))
+        ++pos_;
+}
+
+bool Parser::is_end() const {
+    return pos_ >= source_.size();
+}
+
+char Parser::peek() const {
+    return is_end() ? '\0' : source_[pos_];
+}
+
+void Parser::expect(char c) {
+    if (peek() != c)
+        error(std::string("`") + c + "' expected");
+    ++pos_;
+}
+
+void Parser::error(const std::string& message) const {
+    throw FlatTreeError(message + " at char " + std::to_string(pos_));
+}
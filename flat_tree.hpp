@@ -0,0 +1,124 @@
+#ifndef ANTVIEW_FLAT_TREE_HPP_
+#define ANTVIEW_FLAT_TREE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+class FlatTreeError : public std::invalid_argument {
+public:
+    explicit FlatTreeError(const std::string& what);
+};
+
+// Ant program tree stored as array of nodes in prefix order.
+// Each node is an operation and the size of its subtree, so a subtree
+// is a contiguous range and can be skipped without visiting it.
+// Only ant primitives are supported, each has fixed arity.
+// Copying a tree is a single memory copy.
+class FlatTree {
+public:
+    enum Op : std::uint8_t {
+        OpForward,
+        OpLeft,
+        OpRight,
+        OpIfFoodAhead,
+        OpProgn2,
+        OpProgn3,
+        OpNum
+    };
+
+    struct Node {
+        Op op;
+        std::uint16_t size; // number of nodes in subtree
+    };
+
+    static_assert(sizeof(Node) == 4, "Unexpected node padding");
+
+    using Nodes = std::vector<Node>;
+
+    // Compiled program of max. size tree still fits Program::MaxSize
+    static const std::size_t MaxSize = 0x7fff;
+
+    static unsigned arity(Op op);
+    static const char* name(Op op);
+
+    // Operation by primitive name, OpNum if there is none
+    static Op op(const std::string& name);
+
+    // Parse s-expression in the same format as stree prints it, e.g.
+    // "(if-food-ahead (forward) (progn2 (left) (forward)))";
+    // throws FlatTreeError
+    static FlatTree parse(const std::string& source);
+
+    // Tree from operations in prefix order;
+    // throws FlatTreeError if they are not a single tree
+    static FlatTree from_ops(const std::vector<Op>& ops);
+
+    // Random tree with depth up to `depth' (root is at depth 0),
+    // `full' tree has all terminals at max. depth
+    static FlatTree random(std::mt19937& prng, unsigned depth, bool full);
+
+    // Subtree at random node of `a' replaced with subtree
+    // at random node of `b'
+    static FlatTree crossover(
+        const FlatTree& a,
+        const FlatTree& b,
+        std::mt19937& prng);
+
+    FlatTree() {}
+
+    // Subtree at random node replaced with random tree
+    // of depth up to `depth'
+    FlatTree mutate_subtree(std::mt19937& prng, unsigned depth) const;
+
+    // Random node replaced with another primitive of the same arity,
+    // unchanged if there is none
+    FlatTree mutate_point(std::mt19937& prng) const;
+
+    // Subtree at random node
+    FlatTree mutate_hoist(std::mt19937& prng) const;
+
+    // Subtree at `index'
+    FlatTree subtree(std::size_t index) const;
+
+    // Copy with subtree at `index' replaced with subtree of `other'
+    // at `other_index', unchanged if result is larger than MaxSize
+    FlatTree replace(
+        std::size_t index,
+        const FlatTree& other,
+        std::size_t other_index) const;
+
+    // Max. depth of a node, root is at depth 0
+    unsigned depth() const;
+
+    bool empty() const {
+        return nodes_.empty();
+    }
+
+    std::size_t size() const {
+        return nodes_.size();
+    }
+
+    const Nodes& nodes() const {
+        return nodes_;
+    }
+
+    bool operator==(const FlatTree& other) const;
+
+    bool operator!=(const FlatTree& other) const {
+        return !(*this == other);
+    }
+
+private:
+    std::size_t random_index(std::mt19937& prng) const;
+
+    Nodes nodes_;
+};
+
+std::ostream& operator<<(std::ostream& os, const FlatTree& tree);
+
+#endif
@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <unistd.h>
+#include "geometry.hpp"
+#include "trail.hpp"
+#include "trail_format.hpp"
+
+// Santa-Fe-style trail: a path that never touches itself, food along
+// the path except for gaps. Single gaps and gaps at corners make
+// the trail hard to follow.
+struct TrailParams {
+    TrailParams()
+        : size(32),
+          food_num(89),
+          turn_prob(0.15),
+          gap_prob(0.1),
+          max_gap(3),
+          corner_gap_prob(0.3),
+          seed(1) {}
+
+    Coord size;
+    unsigned food_num;
+    double turn_prob;       // probability to turn at each step
+    double gap_prob;        // probability to start a gap at a straight step
+    unsigned max_gap;       // longest gap
+    double corner_gap_prob; // probability of a gap at a turn
+    unsigned long seed;
+};
+
+// Path bands are this high, including empty row between bands
+static const Coord BandHeight = 8;
+
+static void usage(const std::string& name);
+
+static Trail generate_trail(const TrailParams& params);
+
+int main(int argc, char** argv) {
+    TrailParams params;
+    bool binary = false;
+    std::string filename;
+
+    int opt;
+    try {
+        while ((opt = getopt(argc, argv, "s:n:t:g:m:c:r:bo:h")) != -1) {
+            switch (opt) {
+                case 's': params.size = std::stoi(optarg); break;
+                case 'n': params.food_num = std::stoul(optarg); break;
+                case 't': params.turn_prob = std::stod(optarg); break;
+                case 'g': params.gap_prob = std::stod(optarg); break;
+                case 'm': params.max_gap = std::stoul(optarg); break;
+                case 'c': params.corner_gap_prob = std::stod(optarg); break;
+                case 'r': params.seed = std::stoul(optarg); break;
+                case 'b': binary = true; break;
+                case 'o': filename = optarg; break;
+                default: usage(argv[0]);
+            }
+        }
+    } catch (std::exception& e) {
+        std::cerr << "Invalid argument: " << e.what() << std::endl;
+        usage(argv[0]);
+    }
+    if (optind < argc)
+        usage(argv[0]);
+    if (params.size < BandHeight || params.size > MaxWorldSize) {
+        std::cerr << "Size must be in [" << BandHeight << ", " << MaxWorldSize << "]" << std::endl;
+        std::exit(-1);
+    }
+
+    Trail trail = generate_trail(params);
+    if (trail.size() < params.food_num)
+        std::cerr << "Path is stuck, only " << trail.size()
+                  << " food items placed" << std::endl;
+
+    std::ofstream file;
+    if (!filename.empty()) {
+        file.open(filename, binary ? std::ios::out | std::ios::binary : std::ios::out);
+        if (!file.is_open()) {
+            std::cerr << "Cannot open file `" << filename << "'" << std::endl;
+            std::exit(-1);
+        }
+    }
+    std::ostream& os = filename.empty() ? std::cout : file;
+    if (binary) {
+        write_binary_trail(os, trail, params.size, params.size);
+    } else {
+        os << trail << std::endl;
+    }
+    return os ? 0 : -1;
+}
+
+void usage(const std::string& name) {
+    using namespace std;
+    TrailParams defaults;
+    cout << "Usage:" << endl
+         << name << " [<options>]" << endl
+         << "  -s <size>       world side (" << defaults.size << ")" << endl
+         << "  -n <number>     food items (" << defaults.food_num << ")" << endl
+         << "  -t <prob>       turn probability (" << defaults.turn_prob << ")" << endl
+         << "  -g <prob>       gap probability (" << defaults.gap_prob << ")" << endl
+         << "  -m <length>     max. gap length (" << defaults.max_gap << ")" << endl
+         << "  -c <prob>       gap at corner probability ("
+         << defaults.corner_gap_prob << ")" << endl
+         << "  -r <seed>       random seed (" << defaults.seed << ")" << endl
+         << "  -b              binary output" << endl
+         << "  -o <filename>   output file (stdout)" << endl;
+    exit(-1);
+}
+
+Trail generate_trail(const TrailParams& params) {
+    const Coord size = params.size;
+    const Coord band_num = size / BandHeight;
+    std::mt19937_64 prng(params.seed);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    std::uniform_int_distribution<unsigned> gap_length(
+        1, std::max(params.max_gap, 1u));
+    std::uniform_int_distribution<Coord> band_row(0, BandHeight - 2);
+
+    // Path cells, y * size + x
+    std::unordered_set<std::uint64_t> path;
+    auto cell = [size](Coord x, Coord y) {
+        return static_cast<std::uint64_t>(y) * size + x;
+    };
+
+    // Directions clockwise, starting east
+    const Coord dx[] = {1, 0, -1, 0};
+    const Coord dy[] = {0, 1, 0, -1};
+    enum { East, South, West, North };
+
+    // Ant starts at (0, 0) facing east, so does the path
+    Trail trail;
+    Coord x = 0, y = 0;
+    unsigned dir = East;
+    unsigned gap_left = 0;
+    path.insert(cell(x, y));
+    trail.emplace(x, y);
+
+    // Neither the cell nor its neighbours other than current one are on
+    // the path; never wraps, last row and column are always empty
+    auto is_free = [&](unsigned next_dir) {
+        Coord nx = x + dx[next_dir];
+        Coord ny = y + dy[next_dir];
+        if (path.count(cell(nx, ny)))
+            return false;
+        for (unsigned d = 0; d < 4; ++d) {
+            Coord ax = nx + dx[d];
+            Coord ay = ny + dy[d];
+            if ((ax != x || ay != y) && 0 <= ax && 0 <= ay
+                && path.count(cell(ax, ay)))
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    auto move = [&](unsigned next_dir) {
+        bool turned = (next_dir != dir);
+        dir = next_dir;
+        x += dx[dir];
+        y += dy[dir];
+        path.insert(cell(x, y));
+        if (gap_left > 0) {
+            --gap_left;
+        } else if (turned && chance(prng) < params.corner_gap_prob) {
+            // single cell gap at corner
+        } else if (!turned && chance(prng) < params.gap_prob) {
+            gap_left = gap_length(prng) - 1;
+        } else if (trail.size() < params.food_num) {
+            trail.emplace(x, y);
+        }
+    };
+
+    // Serpentine over bands of rows separated by empty rows;
+    // x only moves forward inside a band, so the path cannot get stuck
+    Coord band = 0;
+    unsigned forward = East;
+    unsigned side = South;
+    unsigned run_left = 0; // steps left in current side run
+    while (trail.size() < params.food_num) {
+        Coord end_x = (forward == East) ? size - 2 : 0;
+        Coord to_end = (forward == East) ? end_x - x : x;
+        if (to_end == 0) {
+            // Go down to next band and turn back
+            if (++band == band_num)
+                break;
+            Coord next_y = band * BandHeight + band_row(prng);
+            while (y < next_y)
+                move(South);
+            forward = (forward == East) ? West : East;
+            move(forward);
+            run_left = 0;
+            continue;
+        }
+
+        // No side runs next to band end, keeps the way down free
+        if (to_end < 2)
+            run_left = 0;
+        else if (run_left == 0 && chance(prng) < params.turn_prob) {
+            side = (chance(prng) < 0.5) ? North : South;
+            run_left = band_row(prng) + 1;
+        }
+        if (run_left > 0) {
+            Coord band_y = y - band * BandHeight;
+            bool inside = (side == North)
+                ? band_y > 0
+                : band_y < BandHeight - 2;
+            if (inside && is_free(side)) {
+                move(side);
+                --run_left;
+                continue;
+            }
+            run_left = 0;
+        }
+        move(forward);
+    }
+    return trail;
+}
@@ -0,0 +1,89 @@
+#ifndef ANTVIEW_GEOMETRY_HPP_
+#define ANTVIEW_GEOMETRY_HPP_
+
+#include "trail.hpp"
+
+// World size known at compile time.
+// Coordinates wrap around on a torus: power-of-two sizes wrap with
+// a mask, other sizes with a compare, moves never divide.
+template<Coord W, Coord H>
+struct Geometry {
+    static_assert(W > 0 && H > 0, "World is empty");
+
+    static const Coord Width = W;
+    static const Coord Height = H;
+    static const unsigned CellNum = W * H;
+
+    static bool contains(Coord x, Coord y) {
+        return 0 <= x && x < Width && 0 <= y && y < Height;
+    }
+
+    // Neighbour coordinates, argument must be inside the world
+    static Coord next_x(Coord x) { return next<W>(x); }
+    static Coord prev_x(Coord x) { return prev<W>(x); }
+    static Coord next_y(Coord y) { return next<H>(y); }
+    static Coord prev_y(Coord y) { return prev<H>(y); }
+
+    // Wrap any coordinate
+    static Coord norm_x(Coord x) { return norm<W>(x); }
+    static Coord norm_y(Coord y) { return norm<H>(y); }
+
+private:
+    template<Coord N>
+    static bool is_pow2() {
+        return (N & (N - 1)) == 0;
+    }
+
+    template<Coord N>
+    static Coord next(Coord c) {
+        if (is_pow2<N>())
+            return (c + 1) & (N - 1);
+        return (c + 1 == N) ? 0 : c + 1;
+    }
+
+    template<Coord N>
+    static Coord prev(Coord c) {
+        if (is_pow2<N>())
+            return (c - 1) & (N - 1);
+        return (c == 0) ? N - 1 : c - 1;
+    }
+
+    template<Coord N>
+    static Coord norm(Coord c) {
+        if (is_pow2<N>())
+            return c & (N - 1);
+        Coord cn = c % N;
+        return (cn < 0) ? cn + N : cn;
+    }
+};
+
+template<Coord W, Coord H> const Coord Geometry<W, H>::Width;
+template<Coord W, Coord H> const Coord Geometry<W, H>::Height;
+template<Coord W, Coord H> const unsigned Geometry<W, H>::CellNum;
+
+// Worlds with compiled code, smallest first
+using World32 = Geometry<32, 32>;
+using World64 = Geometry<64, 64>;
+using World128 = Geometry<128, 128>;
+using World256 = Geometry<256, 256>;
+
+// World of any power-of-two size up to MaxWorldSize chosen at run
+// time, grid stores food sparsely, see BasicGrid<SparseWorld>
+struct SparseWorld {};
+
+// Largest world side, cell index fits 32 bits
+const Coord MaxWorldSize = 0x10000;
+
+// Apply macro `M' to each world with size known at compile time
+#define ANTVIEW_FOR_EACH_DENSE_WORLD(M) \
+    M(World32) \
+    M(World64) \
+    M(World128) \
+    M(World256)
+
+// Apply macro `M' to each world, used for explicit instantiations
+#define ANTVIEW_FOR_EACH_WORLD(M) \
+    ANTVIEW_FOR_EACH_DENSE_WORLD(M) \
+    M(SparseWorld)
+
+#endif
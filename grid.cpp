@@ -0,0 +1,235 @@
+#include "grid.hpp"
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+template<typename G>
+BasicGrid<G>::BasicGrid(const Trail& trail)
+    : words_()
+{
+    for (const Pos& pos : trail) {
+        if (!contains(pos.first, pos.second))
+            throw std::out_of_range(
+                "Trail position ("
+                + std::to_string(pos.first) + " "
+                + std::to_string(pos.second) + ") is out of grid");
+        set(pos.first, pos.second);
+    }
+}
+
+template<typename G>
+BasicGrid<G>::BasicGrid(const Trail& trail, Coord width, Coord height)
+    : BasicGrid(trail)
+{
+    if (width > Width || height > Height)
+        throw std::out_of_range(
+            "World " + std::to_string(width) + "x" + std::to_string(height)
+            + " is larger than the grid");
+}
+
+template<typename G>
+BasicGrid<G>::BasicGrid(const BinaryTrail& trail)
+    : words_()
+{
+    if (trail.width() > Width || trail.height() > Height)
+        throw std::out_of_range(
+            "World " + std::to_string(trail.width())
+            + "x" + std::to_string(trail.height())
+            + " is larger than the grid");
+    // Positions are inside the stored world
+    for (std::size_t i = 0; i < trail.size(); ++i) {
+        Pos pos = trail[i];
+        set(pos.first, pos.second);
+    }
+}
+
+template<typename G>
+unsigned BasicGrid<G>::count() const {
+    unsigned num = 0;
+    for (Word word : words_)
+        num += __builtin_popcountll(word);
+    return num;
+}
+
+template<typename G>
+Trail BasicGrid<G>::trail() const {
+    Trail trail;
+    for (Coord y = 0; y < Height; ++y) {
+        for (unsigned i = 0; i < RowSize; ++i) {
+            Word word = words_[y * RowSize + i];
+            while (word) {
+                Coord x = i * WordBits + __builtin_ctzll(word);
+                trail.emplace(x, y);
+                word &= word - 1;
+            }
+        }
+    }
+    return trail;
+}
+
+// Side of world `G' for trail of given size
+template<typename G>
+static Coord world_side(G, Coord) {
+    return G::Width;
+}
+
+static Coord world_side(SparseWorld, Coord size) {
+    Coord side = 1;
+    while (side < size)
+        side *= 2;
+    return side;
+}
+
+template<typename G>
+DistanceMap::DistanceMap(const BasicGrid<G>& grid)
+    : width_(G::Width),
+      distances_(G::CellNum, Infinity)
+{
+    // Breadth-first search from all food cells at once
+    std::vector<Pos> queue;
+    queue.reserve(G::CellNum);
+    for (Coord y = 0; y < G::Height; ++y) {
+        for (Coord x = 0; x < G::Width; ++x) {
+            if (grid.get(x, y)) {
+                distances_[y * G::Width + x] = 0;
+                queue.emplace_back(x, y);
+            }
+        }
+    }
+    for (std::size_t i = 0; i < queue.size(); ++i) {
+        Coord x = queue[i].first;
+        Coord y = queue[i].second;
+        std::uint16_t next = distances_[y * G::Width + x] + 1;
+        const Pos neighbours[] = {
+            Pos(x, G::prev_y(y)),
+            Pos(G::next_x(x), y),
+            Pos(x, G::next_y(y)),
+            Pos(G::prev_x(x), y)};
+        for (const Pos& pos : neighbours) {
+            std::uint16_t& distance =
+                distances_[pos.second * G::Width + pos.first];
+            if (distance == Infinity) {
+                distance = next;
+                queue.push_back(pos);
+            }
+        }
+    }
+}
+
+template<>
+DistanceMap::DistanceMap(const SparseGrid&)
+    : width_(0) {}
+
+// Side of sparse grid for world side
+static Coord sparse_side(Coord size) {
+    if (size > MaxWorldSize)
+        throw std::out_of_range(
+            "World size " + std::to_string(size) + " is not supported");
+    return world_side(SparseWorld(), std::max(size, SparseGrid::ChunkSize));
+}
+
+BasicGrid<SparseWorld>::BasicGrid(const Trail& trail)
+    : BasicGrid(trail, world_size(trail), world_size(trail)) {}
+
+BasicGrid<SparseWorld>::BasicGrid(const Trail& trail, Coord width, Coord height)
+    : BasicGrid(sparse_side(width), sparse_side(height))
+{
+    for (const Pos& pos : trail) {
+        if (!contains(pos.first, pos.second))
+            throw std::out_of_range(
+                "Trail position ("
+                + std::to_string(pos.first) + " "
+                + std::to_string(pos.second) + ") is out of grid");
+        set(pos.first, pos.second);
+    }
+}
+
+BasicGrid<SparseWorld>::BasicGrid(const BinaryTrail& trail)
+    : BasicGrid(sparse_side(trail.width()), sparse_side(trail.height()))
+{
+    // Positions are inside the stored world
+    for (std::size_t i = 0; i < trail.size(); ++i) {
+        Pos pos = trail[i];
+        set(pos.first, pos.second);
+    }
+}
+
+BasicGrid<SparseWorld>::BasicGrid(Coord width, Coord height)
+    : mask_x_(width - 1),
+      mask_y_(height - 1),
+      shift_x_(__builtin_ctz(width)),
+      chunk_shift_(shift_x_ - ChunkBits),
+      directory_((width >> ChunkBits) * (height >> ChunkBits), 0),
+      chunks_(1, Chunk()) // empty chunk
+{
+    assert(ChunkSize <= width && width <= MaxWorldSize);
+    assert(ChunkSize <= height && height <= MaxWorldSize);
+    assert((width & (width - 1)) == 0 && (height & (height - 1)) == 0);
+}
+
+void BasicGrid<SparseWorld>::set(Coord x, Coord y) {
+    std::uint32_t& index = directory_[chunk_index(x, y)];
+    if (index == 0) {
+        index = chunks_.size();
+        chunks_.emplace_back();
+    }
+    chunks_[index][y & (ChunkSize - 1)] |= Word(1) << (x & (ChunkSize - 1));
+}
+
+unsigned BasicGrid<SparseWorld>::count() const {
+    unsigned num = 0;
+    for (const Chunk& chunk : chunks_) {
+        for (Word word : chunk)
+            num += __builtin_popcountll(word);
+    }
+    return num;
+}
+
+Trail BasicGrid<SparseWorld>::trail() const {
+    Trail trail;
+    Coord chunk_cols = width() >> ChunkBits;
+    for (std::size_t i = 0; i < directory_.size(); ++i) {
+        if (directory_[i] == 0)
+            continue;
+        const Chunk& chunk = chunks_[directory_[i]];
+        Coord x0 = (i % chunk_cols) << ChunkBits;
+        Coord y0 = (i / chunk_cols) << ChunkBits;
+        for (Coord y = 0; y < ChunkSize; ++y) {
+            Word word = chunk[y];
+            while (word) {
+                trail.emplace(x0 + __builtin_ctzll(word), y0 + y);
+                word &= word - 1;
+            }
+        }
+    }
+    return trail;
+}
+
+Coord world_size(const Trail& trail) {
+    // Ant starts at (0, 0)
+    Coord size = 1;
+    for (const Pos& pos : trail) {
+        if (pos.first < 0 || pos.second < 0)
+            throw std::out_of_range(
+                "Trail position ("
+                + std::to_string(pos.first) + " "
+                + std::to_string(pos.second) + ") is negative");
+        size = std::max(size, std::max(pos.first, pos.second) + 1);
+    }
+    return world_size(size, size);
+}
+
+Coord world_size(Coord width, Coord height) {
+    Coord size = std::max({Coord(1), width, height});
+    return with_world(size, [size](auto world) {
+        return world_side(world, size);
+    });
+}
+
+#define ANTVIEW_INSTANTIATE(World) \
+    template class BasicGrid<World>; \
+    template DistanceMap::DistanceMap(const BasicGrid<World>&);
+ANTVIEW_FOR_EACH_DENSE_WORLD(ANTVIEW_INSTANTIATE)
+#undef ANTVIEW_INSTANTIATE
@@ -0,0 +1,282 @@
+#ifndef ANTVIEW_GRID_HPP_
+#define ANTVIEW_GRID_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "geometry.hpp"
+#include "trail.hpp"
+#include "trail_format.hpp"
+
+// Food grid packed into machine words, one or more words per row.
+// 32x32 grid is one 32-bit word per row, copying it is a plain
+// 128-byte copy.
+template<typename G>
+class BasicGrid {
+public:
+    using World = G;
+    using Word = typename std::conditional<
+        (G::Width <= 32), std::uint32_t, std::uint64_t>::type;
+
+    static const Coord Width = G::Width;
+    static const Coord Height = G::Height;
+
+    BasicGrid() : words_() {}
+    explicit BasicGrid(const Trail& trail);
+
+    // Trail in world of given size, or in world stored in binary trail;
+    // throws std::out_of_range if the world is larger than the grid
+    BasicGrid(const Trail& trail, Coord width, Coord height);
+    explicit BasicGrid(const BinaryTrail& trail);
+
+    static Coord width() {
+        return Width;
+    }
+
+    static Coord height() {
+        return Height;
+    }
+
+    static std::size_t cell_num() {
+        return G::CellNum;
+    }
+
+    static bool contains(Coord x, Coord y) {
+        return G::contains(x, y);
+    }
+
+    // Neighbour coordinates, see Geometry
+    static Coord next_x(Coord x) { return G::next_x(x); }
+    static Coord prev_x(Coord x) { return G::prev_x(x); }
+    static Coord next_y(Coord y) { return G::next_y(y); }
+    static Coord prev_y(Coord y) { return G::prev_y(y); }
+
+    // Cell index is y * Width + x
+    static std::uint32_t cell(Coord x, Coord y) {
+        return y * Width + x;
+    }
+
+    static Coord cell_x(std::uint32_t cell) {
+        return cell % Width;
+    }
+
+    static Coord cell_y(std::uint32_t cell) {
+        return cell / Width;
+    }
+
+    bool get(Coord x, Coord y) const {
+        return (words_[index(x, y)] >> shift(x)) & 1;
+    }
+
+    void set(Coord x, Coord y) {
+        words_[index(x, y)] |= Word(1) << shift(x);
+    }
+
+    // Clear cell, return 1 if there was food, 0 otherwise
+    unsigned take(Coord x, Coord y) {
+        Word& word = words_[index(x, y)];
+        Word mask = Word(1) << shift(x);
+        unsigned food = (word & mask) != 0;
+        word &= ~mask;
+        return food;
+    }
+
+    // Restore food from `base' this grid was copied from
+    void refill(const BasicGrid& base) {
+        *this = base;
+    }
+
+    unsigned count() const;
+
+    Trail trail() const;
+
+private:
+    static const unsigned WordBits = sizeof(Word) * 8;
+    static const unsigned RowSize = (Width + WordBits - 1) / WordBits;
+
+    static unsigned index(Coord x, Coord y) {
+        if (RowSize == 1)
+            return y;
+        return y * RowSize + static_cast<unsigned>(x) / WordBits;
+    }
+
+    static unsigned shift(Coord x) {
+        return static_cast<unsigned>(x) % WordBits;
+    }
+
+    std::array<Word, Height * RowSize> words_;
+};
+
+template<typename G> const Coord BasicGrid<G>::Width;
+template<typename G> const Coord BasicGrid<G>::Height;
+
+// Food grid of runtime power-of-two size stored in 64x64 chunks,
+// chunks are allocated only where there is food. Chunk directory
+// maps chunk position to a chunk, all empty positions share one empty
+// chunk, so a lookup is two array reads and memory depends on trail
+// size rather than on grid size (directory is 4 bytes per chunk).
+template<>
+class BasicGrid<SparseWorld> {
+public:
+    using World = SparseWorld;
+    using Word = std::uint64_t;
+
+    static const unsigned ChunkBits = 6;
+    static const Coord ChunkSize = 1 << ChunkBits;
+
+    BasicGrid() : BasicGrid(Trail()) {}
+
+    // Smallest size containing the trail, see world_size()
+    explicit BasicGrid(const Trail& trail);
+
+    // Trail in world of given size, or in world stored in binary trail,
+    // sides are rounded up to powers of two of at least ChunkSize;
+    // throws std::out_of_range if the world is too large
+    BasicGrid(const Trail& trail, Coord width, Coord height);
+    explicit BasicGrid(const BinaryTrail& trail);
+
+    Coord width() const {
+        return mask_x_ + 1;
+    }
+
+    Coord height() const {
+        return mask_y_ + 1;
+    }
+
+    std::size_t cell_num() const {
+        return static_cast<std::size_t>(width()) * height();
+    }
+
+    bool contains(Coord x, Coord y) const {
+        return 0 <= x && x <= mask_x_ && 0 <= y && y <= mask_y_;
+    }
+
+    Coord next_x(Coord x) const { return (x + 1) & mask_x_; }
+    Coord prev_x(Coord x) const { return (x - 1) & mask_x_; }
+    Coord next_y(Coord y) const { return (y + 1) & mask_y_; }
+    Coord prev_y(Coord y) const { return (y - 1) & mask_y_; }
+
+    // Cell index is y * width() + x
+    std::uint32_t cell(Coord x, Coord y) const {
+        return (static_cast<std::uint32_t>(y) << shift_x_) | x;
+    }
+
+    Coord cell_x(std::uint32_t cell) const {
+        return cell & mask_x_;
+    }
+
+    Coord cell_y(std::uint32_t cell) const {
+        return cell >> shift_x_;
+    }
+
+    bool get(Coord x, Coord y) const {
+        return (chunk(x, y)[y & (ChunkSize - 1)] >> (x & (ChunkSize - 1))) & 1;
+    }
+
+    void set(Coord x, Coord y);
+
+    // Clear cell, return 1 if there was food, 0 otherwise;
+    // never writes to shared empty chunk
+    unsigned take(Coord x, Coord y) {
+        Word& word = chunks_[directory_[chunk_index(x, y)]][y & (ChunkSize - 1)];
+        Word mask = Word(1) << (x & (ChunkSize - 1));
+        if (!(word & mask))
+            return 0;
+        word &= ~mask;
+        return 1;
+    }
+
+    // Restore food from `base' this grid was copied from,
+    // directory doesn't change so only chunks are copied
+    void refill(const BasicGrid& base) {
+        chunks_ = base.chunks_;
+    }
+
+    unsigned count() const;
+
+    Trail trail() const;
+
+private:
+    using Chunk = std::array<Word, ChunkSize>;
+
+    // Empty grid, sides must be powers of two in [ChunkSize, MaxWorldSize]
+    BasicGrid(Coord width, Coord height);
+
+    unsigned chunk_index(Coord x, Coord y) const {
+        return ((static_cast<unsigned>(y) >> ChunkBits) << chunk_shift_)
+            | (static_cast<unsigned>(x) >> ChunkBits);
+    }
+
+    const Chunk& chunk(Coord x, Coord y) const {
+        return chunks_[directory_[chunk_index(x, y)]];
+    }
+
+    Coord mask_x_;
+    Coord mask_y_;
+    unsigned shift_x_;      // log2(width)
+    unsigned chunk_shift_;  // log2(width / ChunkSize)
+    std::vector<std::uint32_t> directory_; // 0 is empty chunk
+    std::vector<Chunk> chunks_;
+};
+
+using SparseGrid = BasicGrid<SparseWorld>;
+
+// Distance from each cell to nearest food on a grid, counting moves
+// along grid lines on a torus.
+// Sparse grids are too large for a map, distance is 0 for any cell.
+class DistanceMap {
+public:
+    static const unsigned Infinity = 0xffff;
+
+    template<typename G>
+    explicit DistanceMap(const BasicGrid<G>& grid);
+
+    unsigned get(Coord x, Coord y) const {
+        if (distances_.empty())
+            return 0;
+        return distances_[y * width_ + x];
+    }
+
+private:
+    Coord width_;
+    std::vector<std::uint16_t> distances_;
+};
+
+template<>
+DistanceMap::DistanceMap(const SparseGrid& grid);
+
+using Grid = BasicGrid<World32>;
+
+// Side of smallest world containing the trail: size of a world with
+// compile-time size, or power of two up to MaxWorldSize for sparse world;
+// throws std::out_of_range if the trail doesn't fit any world
+Coord world_size(const Trail& trail);
+
+// Side of smallest world of at least given size, e.g. stored
+// in binary trail; throws std::out_of_range if there is no such world
+Coord world_size(Coord width, Coord height);
+
+// Call `fn(world)' with empty object of world type of given size,
+// SparseWorld for sizes above largest compile-time world,
+// return the result
+template<typename F>
+auto with_world(Coord size, F&& fn) -> decltype(fn(World32())) {
+    if (size <= World32::Width)
+        return fn(World32());
+    if (size <= World64::Width)
+        return fn(World64());
+    if (size <= World128::Width)
+        return fn(World128());
+    if (size <= World256::Width)
+        return fn(World256());
+    if (size <= MaxWorldSize)
+        return fn(SparseWorld());
+    throw std::out_of_range(
+        "World size " + std::to_string(size) + " is not supported");
+}
+
+#endif
@@ -0,0 +1,193 @@
+#include "island.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <system_error>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+// Socket pair between islands `a' and `b'
+struct Channel {
+    unsigned a;
+    unsigned b;
+    int fds[2];
+    bool is_result;
+};
+
+[[noreturn]] void throw_error(const char* what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+}
+
+Island::Island(unsigned num, unsigned topology)
+    : index_(0),
+      num_(std::max(num, 1u)),
+      topology_(topology)
+{
+    if (num_ == 1)
+        return;
+
+    // Create all channels before forking
+    std::vector<Channel> channels;
+    auto add_channel = [&channels](unsigned a, unsigned b, bool is_result) {
+        Channel channel{a, b, {-1, -1}, is_result};
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, channel.fds) == -1)
+            throw_error("socketpair");
+        channels.push_back(channel);
+    };
+    for (unsigned i = 0; i < num_; ++i) {
+        for (unsigned j = i + 1; j < num_; ++j) {
+            bool linked = (topology_ == TopologyAll)
+                || j == i + 1
+                || (i == 0 && j == num_ - 1);
+            if (linked)
+                add_channel(i, j, false);
+        }
+    }
+    for (unsigned i = 1; i < num_; ++i)
+        add_channel(0, i, true);
+
+    // Buffered output would be written by every process
+    std::fflush(nullptr);
+    for (unsigned i = 1; i < num_ && index_ == 0; ++i) {
+        pid_t pid = fork();
+        if (pid == -1)
+            throw_error("fork");
+        if (pid == 0) {
+            index_ = i;
+            children_.clear();
+        } else {
+            children_.push_back(pid);
+        }
+    }
+
+    // Keep own ends of channels
+    for (Channel& channel : channels) {
+        for (unsigned end = 0; end < 2; ++end) {
+            unsigned self = end ? channel.b : channel.a;
+            unsigned peer = end ? channel.a : channel.b;
+            if (self == index_) {
+                Link link{peer, channel.fds[end]};
+                (channel.is_result ? results_ : links_).push_back(link);
+            } else {
+                close(channel.fds[end]);
+            }
+        }
+    }
+}
+
+Island::~Island() {
+    close_all();
+    for (pid_t pid : children_)
+        waitpid(pid, nullptr, 0);
+}
+
+void Island::send(const Trees& trees) {
+    for (const Link& link : links_) {
+        // Ring: only to next island
+        if (topology_ == TopologyRing && link.peer != (index_ + 1) % num_)
+            continue;
+        for (const std::string& tree : trees)
+            send_tree(link.fd, tree, false);
+    }
+}
+
+Island::Trees Island::receive() {
+    Trees trees;
+    std::string tree;
+    for (const Link& link : links_) {
+        while (receive_tree(link.fd, tree, false))
+            trees.push_back(tree);
+    }
+    return trees;
+}
+
+bool Island::send_results(const Trees& trees) {
+    // Each part starts with '+' if more parts of the tree follow,
+    // '.' otherwise
+    std::string part;
+    for (const Link& link : results_) {
+        for (const std::string& tree : trees) {
+            std::size_t pos = 0;
+            do {
+                std::size_t size = std::min(PartSize, tree.size() - pos);
+                part.assign(1, (pos + size < tree.size()) ? '+' : '.');
+                part.append(tree, pos, size);
+                if (!send_tree(link.fd, part, true))
+                    return false;
+                pos += size;
+            } while (pos < tree.size());
+        }
+        // Empty message ends results
+        if (!send_tree(link.fd, std::string(), true))
+            return false;
+    }
+    return true;
+}
+
+Island::Trees Island::collect_results() {
+    Trees trees;
+    std::string tree;
+    std::string part;
+    for (const Link& link : results_) {
+        tree.clear();
+        while (receive_tree(link.fd, part, true)) {
+            tree.append(part, 1, std::string::npos);
+            if (part[0] == '.') {
+                trees.push_back(tree);
+                tree.clear();
+            }
+        }
+    }
+    close_all();
+    for (pid_t pid : children_)
+        waitpid(pid, nullptr, 0);
+    children_.clear();
+    return trees;
+}
+
+bool Island::send_tree(int fd, const std::string& tree, bool wait) {
+    int flags = MSG_NOSIGNAL | (wait ? 0 : MSG_DONTWAIT);
+    ssize_t size;
+    do {
+        size = ::send(fd, tree.data(), tree.size(), flags);
+    } while (size == -1 && errno == EINTR);
+    // Full buffer, peer gone or tree too long for a message: drop it
+    return size != -1;
+}
+
+bool Island::receive_tree(int fd, std::string& tree, bool wait) {
+    int flags = wait ? 0 : MSG_DONTWAIT;
+    auto receive = [fd](void* data, std::size_t size, int flags) {
+        ssize_t result;
+        do {
+            result = recv(fd, data, size, flags);
+        } while (result == -1 && errno == EINTR);
+        return result;
+    };
+
+    // Peek for message size, zero is either end of results
+    // or closed socket
+    char byte;
+    ssize_t size = receive(&byte, 1, flags | MSG_PEEK | MSG_TRUNC);
+    if (size == 0)
+        receive(&byte, 1, flags);
+    if (size <= 0)
+        return false;
+    tree.resize(size);
+    return receive(&tree[0], tree.size(), flags) == size;
+}
+
+void Island::close_all() {
+    for (const Link& link : links_)
+        close(link.fd);
+    for (const Link& link : results_)
+        close(link.fd);
+    links_.clear();
+    results_.clear();
+}
@@ -0,0 +1,85 @@
+#ifndef ANTVIEW_ISLAND_HPP_
+#define ANTVIEW_ISLAND_HPP_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+enum MigrationTopology {
+    TopologyRing, // island sends to next one
+    TopologyAll   // island sends to every other one
+};
+
+// Island model: populations evolve in separate processes and exchange
+// their best individuals. Islands are forked from the main process and
+// talk over Unix socket pairs, one tree source per message. Sending
+// never waits, a tree is dropped if receiver's buffer is full, so
+// islands don't synchronize until final results are collected.
+// Results are sent in parts, so trees of any size get through.
+class Island {
+public:
+    using Trees = std::vector<std::string>;
+
+    // Fork `num - 1' processes, each returns as its own island,
+    // calling process is island 0;
+    // throws std::system_error on failure
+    Island(unsigned num, unsigned topology);
+    ~Island();
+
+    Island(const Island&) = delete;
+    Island& operator=(const Island&) = delete;
+
+    unsigned index() const {
+        return index_;
+    }
+
+    unsigned num() const {
+        return num_;
+    }
+
+    bool is_main() const {
+        return index_ == 0;
+    }
+
+    // Send trees to neighbours according to topology
+    void send(const Trees& trees);
+
+    // Trees received from neighbours since last call
+    Trees receive();
+
+    // Other islands: send final results to main island,
+    // return false if main island is gone
+    bool send_results(const Trees& trees);
+
+    // Main island: wait for results of other islands
+    // and for their processes to exit
+    Trees collect_results();
+
+private:
+    struct Link {
+        unsigned peer;
+        int fd;
+    };
+
+    // Result part size, well below socket buffer size
+    static const std::size_t PartSize = 1 << 15;
+
+    static bool send_tree(int fd, const std::string& tree, bool wait);
+
+    // Return false if there is nothing to read, peer is gone
+    // or message is empty
+    static bool receive_tree(int fd, std::string& tree, bool wait);
+
+    void close_all();
+
+    unsigned index_;
+    unsigned num_;
+    unsigned topology_;
+    std::vector<Link> links_;   // migration
+    std::vector<Link> results_; // main island: link per island,
+                                // other islands: link to main one
+    std::vector<pid_t> children_;
+};
+
+#endif
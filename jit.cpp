@@ -0,0 +1,339 @@
+#include "jit.hpp"
+#include <cassert>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#if defined(__x86_64__) && defined(__unix__)
+# define ANTVIEW_JIT 1
+# include <sys/mman.h>
+#endif
+
+#ifdef ANTVIEW_JIT
+
+template<typename A>
+static void jit_forward(A* ant) {
+    ant->forward();
+}
+
+template<typename A>
+static void jit_left(A* ant) {
+    ant->left();
+}
+
+template<typename A>
+static void jit_right(A* ant) {
+    ant->right();
+}
+
+template<typename A>
+static bool jit_is_food_ahead(const A* ant) {
+    return ant->is_food_ahead();
+}
+
+template<typename A>
+static int jit_check(const A* ant, RunChecks* checks, unsigned steps_left) {
+    return checks ? checks->check(*ant, steps_left) : RunDone;
+}
+
+namespace {
+
+// Ant functions called by generated code
+struct Helpers {
+    template<typename A>
+    static Helpers make() {
+        return {
+            reinterpret_cast<const void*>(jit_forward<A>),
+            reinterpret_cast<const void*>(jit_left<A>),
+            reinterpret_cast<const void*>(jit_right<A>),
+            reinterpret_cast<const void*>(jit_is_food_ahead<A>),
+            reinterpret_cast<const void*>(jit_check<A>)};
+    }
+
+    const void* forward;
+    const void* left;
+    const void* right;
+    const void* is_food_ahead;
+    const void* check;
+};
+
+// x86-64 System V code emitter.
+// Generated function: int (Ant* ant, unsigned steps, RunChecks* checks)
+// returning RunStatus; ant pointer is kept in rbx, remaining steps
+// in r12d, checks in r13.
+class Emitter {
+public:
+    Emitter(std::vector<std::uint8_t>& buffer, const Helpers& helpers)
+        : buffer_(buffer),
+          helpers_(helpers) {}
+
+    void emit(const Program& program);
+
+private:
+    void prologue();
+    void epilogue();
+    void run_checks();
+    void action(const void* function);
+    void if_food_ahead(unsigned target);
+    void jump(unsigned target);
+    void call(const void* function);
+
+    void bytes(std::initializer_list<std::uint8_t> list);
+    void imm32(std::uint32_t value);
+    void imm64(std::uint64_t value);
+    void rel32_to_instr(unsigned target);
+    void rel32_to_exit();
+    void rel32_to_status_exit();
+
+    std::vector<std::uint8_t>& buffer_;
+    Helpers helpers_;
+    std::vector<std::size_t> instr_offsets_;
+    // (rel32 position, target instruction)
+    std::vector<std::pair<std::size_t, unsigned>> instr_fixups_;
+    std::vector<std::size_t> exit_fixups_;
+    std::vector<std::size_t> status_exit_fixups_;
+};
+
+}
+
+static void patch_rel32(
+    std::vector<std::uint8_t>& buffer,
+    std::size_t pos,
+    std::size_t target);
+
+#endif // ANTVIEW_JIT
+
+
+template<typename G>
+bool BasicJitBatch<G>::is_supported() {
+#ifdef ANTVIEW_JIT
+    return true;
+#else
+    return false;
+#endif
+}
+
+template<typename G>
+BasicJitBatch<G>::BasicJitBatch()
+    : code_(nullptr),
+      code_size_(0) {}
+
+template<typename G>
+BasicJitBatch<G>::~BasicJitBatch() {
+    clear();
+}
+
+template<typename G>
+std::size_t BasicJitBatch<G>::add(const Program& program) {
+    assert(!code_ && "JIT batch is finalized");
+#ifdef ANTVIEW_JIT
+    offsets_.push_back(buffer_.size());
+    Emitter(buffer_, Helpers::make<Ant>()).emit(program);
+    return offsets_.size() - 1;
+#else
+    (void) program;
+    throw std::logic_error("JIT is not supported on this platform");
+#endif
+}
+
+template<typename G>
+void BasicJitBatch<G>::finalize() {
+    assert(!code_ && "JIT batch is already finalized");
+#ifdef ANTVIEW_JIT
+    if (buffer_.empty())
+        return;
+    code_size_ = buffer_.size();
+    void* code = mmap(
+        nullptr, code_size_,
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS,
+        -1, 0);
+    if (code == MAP_FAILED)
+        throw std::bad_alloc();
+    std::memcpy(code, buffer_.data(), code_size_);
+    if (mprotect(code, code_size_, PROT_READ | PROT_EXEC) != 0) {
+        munmap(code, code_size_);
+        throw std::bad_alloc();
+    }
+    code_ = code;
+#endif
+}
+
+template<typename G>
+void BasicJitBatch<G>::clear() {
+#ifdef ANTVIEW_JIT
+    if (code_)
+        munmap(code_, code_size_);
+#endif
+    code_ = nullptr;
+    code_size_ = 0;
+    buffer_.clear();
+    offsets_.clear();
+}
+
+template<typename G>
+RunStatus BasicJitBatch<G>::run(
+    std::size_t index,
+    Ant& ant,
+    unsigned step_limit,
+    RunChecks* checks) const
+{
+    assert(code_ && "JIT batch is not finalized");
+    assert(index < offsets_.size());
+    if (ant.action_num() >= step_limit)
+        return RunDone;
+    if (checks)
+        checks->reset();
+    auto function = reinterpret_cast<Function>(
+        static_cast<std::uint8_t*>(code_) + offsets_[index]);
+    return static_cast<RunStatus>(
+        function(&ant, step_limit - ant.action_num(), checks));
+}
+
+#define ANTVIEW_INSTANTIATE(World) \
+    template class BasicJitBatch<World>;
+ANTVIEW_FOR_EACH_WORLD(ANTVIEW_INSTANTIATE)
+#undef ANTVIEW_INSTANTIATE
+
+
+#ifdef ANTVIEW_JIT
+
+void Emitter::emit(const Program& program) {
+    prologue();
+    for (const Program::Instr& instr : program.code()) {
+        instr_offsets_.push_back(buffer_.size());
+        if (instr_offsets_.size() == 1)
+            run_checks(); // program start
+        switch (instr.op) {
+            case Program::OpForward:
+                action(helpers_.forward);
+                break;
+            case Program::OpLeft:
+                action(helpers_.left);
+                break;
+            case Program::OpRight:
+                action(helpers_.right);
+                break;
+            case Program::OpIfFoodAhead:
+                if_food_ahead(instr.arg);
+                break;
+            case Program::OpJump:
+                jump(instr.arg);
+                break;
+        }
+    }
+    // Exit, return RunDone
+    std::size_t exit = buffer_.size();
+    bytes({0x31, 0xc0});             // xor eax, eax
+    // Exit with status in eax
+    std::size_t status_exit = buffer_.size();
+    epilogue();
+
+    // Resolve jumps
+    for (const auto& fixup : instr_fixups_) {
+        assert(fixup.second < instr_offsets_.size());
+        patch_rel32(buffer_, fixup.first, instr_offsets_[fixup.second]);
+    }
+    for (std::size_t pos : exit_fixups_)
+        patch_rel32(buffer_, pos, exit);
+    for (std::size_t pos : status_exit_fixups_)
+        patch_rel32(buffer_, pos, status_exit);
+}
+
+void Emitter::prologue() {
+    // Three pushes keep the stack 16-byte aligned for calls
+    bytes({0x53});                   // push rbx
+    bytes({0x41, 0x54});             // push r12
+    bytes({0x41, 0x55});             // push r13
+    bytes({0x48, 0x89, 0xfb});       // mov rbx, rdi
+    bytes({0x41, 0x89, 0xf4});       // mov r12d, esi
+    bytes({0x49, 0x89, 0xd5});       // mov r13, rdx
+}
+
+void Emitter::epilogue() {
+    bytes({0x41, 0x5d});             // pop r13
+    bytes({0x41, 0x5c});             // pop r12
+    bytes({0x5b});                   // pop rbx
+    bytes({0xc3});                   // ret
+}
+
+void Emitter::run_checks() {
+    bytes({0x4c, 0x89, 0xee});       // mov rsi, r13
+    bytes({0x44, 0x89, 0xe2});       // mov edx, r12d
+    call(helpers_.check);
+    bytes({0x85, 0xc0});             // test eax, eax
+    bytes({0x0f, 0x85});             // jnz status_exit
+    rel32_to_status_exit();
+}
+
+void Emitter::action(const void* function) {
+    bytes({0x45, 0x85, 0xe4});       // test r12d, r12d
+    bytes({0x0f, 0x84});             // jz exit
+    rel32_to_exit();
+    bytes({0x41, 0xff, 0xcc});       // dec r12d
+    call(function);
+}
+
+void Emitter::if_food_ahead(unsigned target) {
+    call(helpers_.is_food_ahead);
+    bytes({0x84, 0xc0});             // test al, al
+    bytes({0x0f, 0x84});             // jz target
+    rel32_to_instr(target);
+}
+
+void Emitter::jump(unsigned target) {
+    bytes({0xe9});                   // jmp target
+    rel32_to_instr(target);
+}
+
+void Emitter::call(const void* function) {
+    bytes({0x48, 0x89, 0xdf});       // mov rdi, rbx
+    bytes({0x48, 0xb8});             // mov rax, function
+    imm64(reinterpret_cast<std::uint64_t>(function));
+    bytes({0xff, 0xd0});             // call rax
+}
+
+void Emitter::bytes(std::initializer_list<std::uint8_t> list) {
+    buffer_.insert(buffer_.end(), list);
+}
+
+void Emitter::imm32(std::uint32_t value) {
+    for (unsigned i = 0; i < 4; ++i)
+        buffer_.push_back((value >> (i * 8)) & 0xff);
+}
+
+void Emitter::imm64(std::uint64_t value) {
+    for (unsigned i = 0; i < 8; ++i)
+        buffer_.push_back((value >> (i * 8)) & 0xff);
+}
+
+void Emitter::rel32_to_instr(unsigned target) {
+    instr_fixups_.emplace_back(buffer_.size(), target);
+    imm32(0);
+}
+
+void Emitter::rel32_to_exit() {
+    exit_fixups_.push_back(buffer_.size());
+    imm32(0);
+}
+
+void Emitter::rel32_to_status_exit() {
+    status_exit_fixups_.push_back(buffer_.size());
+    imm32(0);
+}
+
+void patch_rel32(
+    std::vector<std::uint8_t>& buffer,
+    std::size_t pos,
+    std::size_t target)
+{
+    // Relative to the end of rel32 operand
+    auto rel = static_cast<std::int32_t>(
+        static_cast<std::int64_t>(target)
+        - static_cast<std::int64_t>(pos + 4));
+    auto value = static_cast<std::uint32_t>(rel);
+    for (unsigned i = 0; i < 4; ++i)
+        buffer[pos + i] = (value >> (i * 8)) & 0xff;
+}
+
+#endif // ANTVIEW_JIT
@@ -0,0 +1,63 @@
+#ifndef ANTVIEW_JIT_HPP_
+#define ANTVIEW_JIT_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ant.hpp"
+#include "program.hpp"
+
+// Batch of programs compiled to native x86-64 code.
+// Programs are added first, then the batch is finalized: all code is
+// copied into one executable mapping, so memory protection is changed
+// once per batch rather than once per program.
+// Generated code calls ant actions of world `G'.
+template<typename G>
+class BasicJitBatch {
+public:
+    using Ant = BasicAnt<G>;
+
+    static bool is_supported();
+
+    BasicJitBatch();
+    ~BasicJitBatch();
+
+    BasicJitBatch(const BasicJitBatch&) = delete;
+    BasicJitBatch& operator=(const BasicJitBatch&) = delete;
+
+    // Compile program, return its index in batch
+    std::size_t add(const Program& program);
+
+    // Make code executable, no programs can be added after this
+    void finalize();
+
+    // Drop all programs
+    void clear();
+
+    // Run program from the start until ant does `step_limit' actions
+    // or one of `checks' fails
+    RunStatus run(
+        std::size_t index,
+        Ant& ant,
+        unsigned step_limit,
+        RunChecks* checks = nullptr) const;
+
+    std::size_t size() const {
+        return offsets_.size();
+    }
+
+private:
+    using Function = int (*)(
+        Ant* ant,
+        unsigned steps,
+        RunChecks* checks);
+
+    std::vector<std::uint8_t> buffer_;
+    std::vector<std::size_t> offsets_;
+    void* code_;
+    std::size_t code_size_;
+};
+
+using JitBatch = BasicJitBatch<World32>;
+
+#endif
@@ -0,0 +1,224 @@
+#include "lockstep.hpp"
+#include <cassert>
+
+template<typename G>
+const std::vector<typename BasicLockstep<G>::Cell>& BasicLockstep<G>::neighbours() {
+    static const std::vector<Cell> table = []() {
+        std::vector<Cell> table(4 * CellNum);
+        for (Coord y = 0; y < G::Height; ++y) {
+            for (Coord x = 0; x < G::Width; ++x) {
+                Cell* cells = &table[y * G::Width + x];
+                cells[AntBase::N * CellNum] = G::prev_y(y) * G::Width + x;
+                cells[AntBase::E * CellNum] = y * G::Width + G::next_x(x);
+                cells[AntBase::S * CellNum] = G::next_y(y) * G::Width + x;
+                cells[AntBase::W * CellNum] = y * G::Width + G::prev_x(x);
+            }
+        }
+        return table;
+    }();
+    return table;
+}
+
+static unsigned lowest(std::uint64_t mask) {
+    return __builtin_ctzll(mask);
+}
+
+template<typename G>
+BasicLockstep<G>::BasicLockstep(const std::vector<const Grid*>& grids)
+    : lane_num_(grids.size()),
+      lanes_(0),
+      step_limit_(0),
+      base_food_(CellNum, 0),
+      food_num_(),
+      cell_(),
+      dir_(),
+      steps_left_(),
+      food_eaten_(),
+      visited_(grids.size()),
+      cycle_(0)
+{
+    assert(0 < lane_num_ && lane_num_ <= MaxLanes);
+    for (unsigned lane = 0; lane < lane_num_; ++lane) {
+        const Grid& grid = *grids[lane];
+        lanes_ |= Mask(1) << lane;
+        food_num_[lane] = grid.count();
+        for (Coord y = 0; y < G::Height; ++y) {
+            for (Coord x = 0; x < G::Width; ++x) {
+                if (grid.get(x, y))
+                    base_food_[y * G::Width + x] |= Mask(1) << lane;
+            }
+        }
+    }
+    food_ = base_food_;
+    reset();
+}
+
+template<typename G>
+void BasicLockstep<G>::run(const Program& program, unsigned step_limit, bool detect_cycles) {
+    assert(program.size() > 0);
+    step_limit_ = step_limit;
+    reset();
+
+    const Program::Code& code = program.code();
+    pending_.assign(code.size(), 0);
+
+    Mask alive = (step_limit > 0) ? lanes_ : 0;
+    while (alive) {
+        // Program start
+        if (detect_cycles) {
+            Mask cycle = check_cycles(alive);
+            cycle_ |= cycle;
+            alive &= ~cycle;
+        }
+        pending_[0] = alive;
+
+        // Jumps go forward or back to the start, so one pass over
+        // the code runs every lane once through the program
+        Mask next = 0;
+        for (unsigned pc = 0; pc < code.size(); ++pc) {
+            Mask mask = pending_[pc] & alive;
+            if (!mask)
+                continue;
+            pending_[pc] = 0;
+
+            const Program::Instr& instr = code[pc];
+            unsigned target = pc + 1;
+            switch (instr.op) {
+                case Program::OpForward:
+                    alive &= ~forward(mask);
+                    break;
+                case Program::OpLeft:
+                    alive &= ~turn(mask, 3);
+                    break;
+                case Program::OpRight:
+                    alive &= ~turn(mask, 1);
+                    break;
+                case Program::OpIfFoodAhead: {
+                    Mask food = food_ahead(mask);
+                    Mask no_food = mask & ~food;
+                    if (instr.arg == 0) {
+                        next |= no_food;
+                    } else {
+                        assert(instr.arg > pc);
+                        pending_[instr.arg] |= no_food;
+                    }
+                    mask = food;
+                    break;
+                }
+                case Program::OpJump:
+                    target = instr.arg;
+                    break;
+            }
+            mask &= alive;
+            if (target == 0 || target >= code.size()) {
+                next |= mask;
+            } else {
+                assert(target > pc);
+                pending_[target] |= mask;
+            }
+        }
+        alive &= next;
+    }
+}
+
+template<typename G>
+void BasicLockstep<G>::Visited::clear() {
+    for (Key key : keys)
+        bits[key / 64] &= ~(Mask(1) << (key % 64));
+    keys.clear();
+}
+
+template<typename G>
+bool BasicLockstep<G>::Visited::visit(unsigned key) {
+    Mask bit = Mask(1) << (key % 64);
+    if (bits[key / 64] & bit)
+        return true;
+    bits[key / 64] |= bit;
+    keys.push_back(key);
+    return false;
+}
+
+template<typename G>
+void BasicLockstep<G>::reset() {
+    // Put eaten food back, whole grid copy is slow for large worlds
+    for (Cell cell : eaten_)
+        food_[cell] = base_food_[cell];
+    eaten_.clear();
+    cycle_ = 0;
+    for (unsigned lane = 0; lane < lane_num_; ++lane) {
+        cell_[lane] = 0;
+        dir_[lane] = AntBase::E;
+        steps_left_[lane] = step_limit_;
+        food_eaten_[lane] = 0;
+        visited_[lane].clear();
+        eat(lane);
+    }
+}
+
+template<typename G>
+typename BasicLockstep<G>::Mask BasicLockstep<G>::food_ahead(Mask mask) const {
+    const Cell* table = neighbours().data();
+    Mask result = 0;
+    for (; mask; mask &= mask - 1) {
+        unsigned lane = lowest(mask);
+        Cell cell = table[dir_[lane] * CellNum + cell_[lane]];
+        result |= food_[cell] & (Mask(1) << lane);
+    }
+    return result;
+}
+
+template<typename G>
+typename BasicLockstep<G>::Mask BasicLockstep<G>::forward(Mask mask) {
+    const Cell* table = neighbours().data();
+    Mask done = 0;
+    for (; mask; mask &= mask - 1) {
+        unsigned lane = lowest(mask);
+        cell_[lane] = table[dir_[lane] * CellNum + cell_[lane]];
+        eat(lane);
+        if (--steps_left_[lane] == 0)
+            done |= Mask(1) << lane;
+    }
+    return done;
+}
+
+template<typename G>
+typename BasicLockstep<G>::Mask BasicLockstep<G>::turn(Mask mask, unsigned delta) {
+    Mask done = 0;
+    for (; mask; mask &= mask - 1) {
+        unsigned lane = lowest(mask);
+        dir_[lane] = (dir_[lane] + delta) & 3;
+        if (--steps_left_[lane] == 0)
+            done |= Mask(1) << lane;
+    }
+    return done;
+}
+
+template<typename G>
+typename BasicLockstep<G>::Mask BasicLockstep<G>::check_cycles(Mask mask) {
+    Mask cycle = 0;
+    for (; mask; mask &= mask - 1) {
+        unsigned lane = lowest(mask);
+        if (visited_[lane].visit(cell_[lane] * 4 + dir_[lane]))
+            cycle |= Mask(1) << lane;
+    }
+    return cycle;
+}
+
+template<typename G>
+void BasicLockstep<G>::eat(unsigned lane) {
+    Mask bit = Mask(1) << lane;
+    Mask& food = food_[cell_[lane]];
+    if (food & bit) {
+        if (food == base_food_[cell_[lane]])
+            eaten_.push_back(cell_[lane]);
+        food &= ~bit;
+        ++food_eaten_[lane];
+        // Older states cannot repeat
+        visited_[lane].clear();
+    }
+}
+
+#define ANTVIEW_INSTANTIATE(World) \
+    template class BasicLockstep<World>;
+ANTVIEW_FOR_EACH_DENSE_WORLD(ANTVIEW_INSTANTIATE)
+#undef ANTVIEW_INSTANTIATE
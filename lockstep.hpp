@@ -0,0 +1,126 @@
+#ifndef ANTVIEW_LOCKSTEP_HPP_
+#define ANTVIEW_LOCKSTEP_HPP_
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "ant.hpp"
+#include "grid.hpp"
+#include "program.hpp"
+
+// Runs one program on up to 64 trails at once, one trail per lane.
+// Lane sets are 64-bit masks: lanes waiting at the same instruction
+// execute it together, `if-food-ahead' splits the mask and lanes merge
+// again where branches join. Food is stored by cell with one bit per
+// lane, moves use a neighbour table instead of modulo arithmetic.
+// Each lane ends the same way as Program::run on its own trail with
+// cycle detection.
+template<typename G>
+class BasicLockstep {
+public:
+    using Grid = BasicGrid<G>;
+    using Mask = std::uint64_t;
+
+    static const unsigned MaxLanes = 64;
+
+    // Lane for each grid, ants start at (0, 0) facing east
+    explicit BasicLockstep(const std::vector<const Grid*>& grids);
+
+    unsigned lane_num() const {
+        return lane_num_;
+    }
+
+    // Run from the start until each lane does `step_limit' actions
+    // or, if `detect_cycles' is set, repeats its state
+    void run(const Program& program, unsigned step_limit, bool detect_cycles = true);
+
+    // Results of last run
+
+    RunStatus status(unsigned lane) const {
+        return ((cycle_ >> lane) & 1) ? RunCycle : RunDone;
+    }
+
+    unsigned food_left(unsigned lane) const {
+        return food_num_[lane] - food_eaten_[lane];
+    }
+
+    unsigned food_eaten(unsigned lane) const {
+        return food_eaten_[lane];
+    }
+
+    unsigned action_num(unsigned lane) const {
+        return step_limit_ - steps_left_[lane];
+    }
+
+    AntBase::Dir dir(unsigned lane) const {
+        return static_cast<AntBase::Dir>(dir_[lane]);
+    }
+
+    Coord x(unsigned lane) const {
+        return cell_[lane] % G::Width;
+    }
+
+    Coord y(unsigned lane) const {
+        return cell_[lane] / G::Width;
+    }
+
+private:
+    using Cell = std::uint16_t;
+    using Key = std::uint32_t;
+
+    static const unsigned CellNum = G::CellNum;
+    static const unsigned KeyNum = CellNum * 4;
+
+    static_assert(CellNum <= 0x10000, "Cell index doesn't fit");
+
+    // Neighbour cell by direction and cell
+    static const std::vector<Cell>& neighbours();
+
+    // Visited (cell, direction) pairs since last food eaten
+    struct Visited {
+        void clear();
+
+        // Mark as visited, return true if already visited
+        bool visit(unsigned key);
+
+        std::array<Mask, (KeyNum + 63) / 64> bits;
+        std::vector<Key> keys;
+    };
+
+    void reset();
+
+    // Return lanes with food ahead
+    Mask food_ahead(Mask mask) const;
+
+    // Do action, return lanes that are out of steps
+    Mask forward(Mask mask);
+    Mask turn(Mask mask, unsigned delta);
+
+    // Return lanes in a cycle
+    Mask check_cycles(Mask mask);
+
+    void eat(unsigned lane);
+
+    unsigned lane_num_;
+    Mask lanes_;
+    unsigned step_limit_;
+    std::vector<Mask> base_food_; // lanes with food by cell
+    std::vector<Mask> food_;
+    std::vector<Cell> eaten_; // cells to restore on reset
+    std::array<unsigned, MaxLanes> food_num_;
+
+    // Lane state
+    std::array<Cell, MaxLanes> cell_;
+    std::array<std::uint8_t, MaxLanes> dir_;
+    std::array<unsigned, MaxLanes> steps_left_;
+    std::array<unsigned, MaxLanes> food_eaten_;
+    std::vector<Visited> visited_;
+    Mask cycle_;
+
+    // Lanes waiting at each instruction
+    std::vector<Mask> pending_;
+};
+
+using Lockstep = BasicLockstep<World32>;
+
+#endif
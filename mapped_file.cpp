@@ -0,0 +1,54 @@
+#include "mapped_file.hpp"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// "`filename': reason" for error code
+static std::string error_message(const std::string& filename, int error);
+
+MappedFile::MappedFile(const std::string& filename)
+    : data_(nullptr),
+      size_(0)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1)
+        throw std::invalid_argument(error_message(filename, errno));
+
+    struct stat info;
+    if (fstat(fd, &info) == -1) {
+        int error = errno;
+        close(fd);
+        throw std::invalid_argument(error_message(filename, error));
+    }
+    if (!S_ISREG(info.st_mode)) {
+        close(fd);
+        throw std::invalid_argument(
+            "`" + filename + "': Not a regular file");
+    }
+    size_ = info.st_size;
+
+    if (size_ > 0) {
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            int error = errno;
+            close(fd);
+            throw std::runtime_error(error_message(filename, error));
+        }
+        madvise(data, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(data);
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (data_)
+        munmap(const_cast<char*>(data_), size_);
+}
+
+std::string error_message(const std::string& filename, int error) {
+    return "`" + filename + "': " + std::strerror(error);
+}
@@ -0,0 +1,31 @@
+#ifndef ANTVIEW_MAPPED_FILE_HPP_
+#define ANTVIEW_MAPPED_FILE_HPP_
+
+#include <cstddef>
+#include <string>
+
+// Read-only file mapped to memory, empty file has no data;
+// throws std::invalid_argument if file cannot be opened,
+// std::runtime_error if it cannot be mapped
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& filename);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const {
+        return data_;
+    }
+
+    std::size_t size() const {
+        return size_;
+    }
+
+private:
+    const char* data_;
+    std::size_t size_;
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef ANTVIEW_PARALLEL_HPP_
+#define ANTVIEW_PARALLEL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Number of threads to use, 0 means all hardware threads
+inline unsigned thread_num_or_default(unsigned thread_num) {
+    if (thread_num == 0)
+        thread_num = std::max(1u, std::thread::hardware_concurrency());
+    return thread_num;
+}
+
+// Call fn(begin, end, thread_index) for chunks of [0, num).
+// Chunks are handed out dynamically, so fn must not depend on
+// which thread processes which chunk.
+template<typename F>
+void parallel_for(
+    std::size_t num,
+    unsigned thread_num,
+    F fn,
+    std::size_t chunk_size = 64)
+{
+    thread_num = std::max(1u, thread_num);
+    if (thread_num == 1 || num <= chunk_size) {
+        fn(std::size_t{0}, num, 0u);
+        return;
+    }
+
+    std::atomic<std::size_t> next(0);
+    auto worker = [&](unsigned thread_index) {
+        for (;;) {
+            std::size_t begin = next.fetch_add(chunk_size);
+            if (begin >= num)
+                break;
+            fn(begin, std::min(begin + chunk_size, num), thread_index);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(thread_num - 1);
+    for (unsigned i = 1; i < thread_num; ++i)
+        threads.emplace_back(worker, i);
+    worker(0);
+    for (auto& thread : threads)
+        thread.join();
+}
+
+#endif
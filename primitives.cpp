@@ -1,35 +1,173 @@
 #include "primitives.hpp"
+#include <algorithm>
 #include <cassert>
+#include <sstream>
+#include <vector>
 #include "ant.hpp"
 
-static Ant* ant_ptr(stree::DataPtr ant) {
+// Append operations of `subtree' at `depth' in prefix order,
+// update max. depth
+static void append_ops(
+    const stree::Subtree& subtree,
+    unsigned depth,
+    std::vector<FlatTree::Op>& ops,
+    unsigned& depth_max);
+
+// Operations of tree in prefix order, taken from tree nodes into
+// buffer reused by calling thread; set `depth' to max. node depth
+static const std::vector<FlatTree::Op>& tree_ops(
+    const stree::Tree& tree,
+    unsigned& depth);
+
+template<typename A>
+static A* ant_ptr(stree::DataPtr ant) {
     assert(ant);
-    return static_cast<Ant*>(ant);
+    return static_cast<A*>(ant);
 }
 
+template<typename A>
 void init_environment(stree::Environment& env) {
-    env.add_function("forward", 0, ant::forward, 1);
-    env.add_function("left", 0, ant::left, 1);
-    env.add_function("right", 0, ant::right, 1);
+    env.add_function("forward", 0, ant::forward<A>, 1);
+    env.add_function("left", 0, ant::left<A>, 1);
+    env.add_function("right", 0, ant::right<A>, 1);
     env.add_function("progn2", 2, ant::progn);
     env.add_function("progn3", 3, ant::progn);
-    env.add_select_function("if-food-ahead", 2, 0, ant::if_food_ahead);
+    env.add_select_function("if-food-ahead", 2, 0, ant::if_food_ahead<A>);
+}
+
+void init_environment(stree::Environment& env) {
+    init_environment<Ant>(env);
+}
+
+template<typename A>
+void run_tree(stree::Tree& tree, A& ant, unsigned cost_limit) {
+    stree::Exec exec(
+        tree,
+        stree::Exec::FlagRunLoop | stree::Exec::FlagStopIfCostNotZero);
+    stree::Params params;
+    exec.init(&params, static_cast<stree::DataPtr>(&ant));
+    exec.set_cost_limit(cost_limit);
+    try {
+        exec.run();
+    } catch (stree::ExecCostLimitExceeded& e) {
+        // do nothing
+    }
+}
+
+Program compile_program(const stree::Tree& tree) {
+    unsigned depth = 0;
+    return Program::compile(tree_ops(tree, depth));
+}
+
+void compile_program(const stree::Tree& tree, Program& program) {
+    unsigned depth = 0;
+    Program::compile(tree_ops(tree, depth), program);
+}
+
+TreeShape tree_shape(const stree::Tree& tree) {
+    TreeShape shape{0, 0};
+    shape.size = tree_ops(tree, shape.depth).size();
+    return shape;
+}
+
+FlatTree make_flat_tree(const stree::Tree& tree) {
+    unsigned depth = 0;
+    return FlatTree::from_ops(tree_ops(tree, depth));
+}
+
+stree::Tree make_tree(stree::Environment& env, const FlatTree& tree) {
+    std::stringstream ss;
+    ss << tree;
+    stree::Parser parser(&env);
+    parser.parse(ss);
+    if (!parser.is_done())
+        throw stree::ParserError(parser);
+    return stree::Tree(&env, parser.move_result());
+}
+
+void append_ops(
+    const stree::Subtree& subtree,
+    unsigned depth,
+    std::vector<FlatTree::Op>& ops,
+    unsigned& depth_max)
+{
+    FlatTree::Op op = FlatTree::op(subtree.symbol()->name());
+    if (op == FlatTree::OpNum)
+        throw ProgramError("unknown symbol `" + subtree.symbol()->name() + "'");
+    assert(subtree.arity() == FlatTree::arity(op));
+    ops.push_back(op);
+    depth_max = std::max(depth_max, depth);
+    for (unsigned i = 0; i < FlatTree::arity(op); ++i)
+        append_ops(subtree.argument(i), depth + 1, ops, depth_max);
+}
+
+const std::vector<FlatTree::Op>& tree_ops(
+    const stree::Tree& tree,
+    unsigned& depth)
+{
+    thread_local std::vector<FlatTree::Op> ops;
+    ops.clear();
+    depth = 0;
+    append_ops(tree.sub(0), 0, ops, depth);
+    return ops;
+}
+
+template<typename G>
+bool check_program(
+    stree::Tree& tree,
+    const Program& program,
+    const BasicGrid<G>& grid,
+    unsigned step_limit,
+    std::ostream& os)
+{
+    // stree::Exec
+    BasicAnt<G> exec_ant(grid);
+    stree::Exec exec(
+        tree,
+        stree::Exec::FlagRunLoop | stree::Exec::FlagStopIfCostNotZero);
+    stree::Params params;
+    exec.init(&params, static_cast<stree::DataPtr>(&exec_ant));
+    exec.set_cost_limit(0);
+
+    // Compiled program
+    BasicAnt<G> program_ant(grid);
+    unsigned pc = 0;
+
+    for (unsigned step = 0; step < step_limit; ++step) {
+        exec.step();
+        pc = program.step(program_ant, pc);
+        if (exec_ant.dir() != program_ant.dir()
+            || exec_ant.x() != program_ant.x()
+            || exec_ant.y() != program_ant.y()
+            || exec_ant.food_eaten() != program_ant.food_eaten()
+            || exec_ant.action_num() != program_ant.action_num())
+        {
+            os << "Step " << step << std::endl
+               << "Exec:    " << exec_ant << std::endl
+               << "Program: " << program_ant << std::endl;
+            return false;
+        }
+    }
+    return true;
 }
 
 namespace ant {
 
+template<typename A>
 stree::Value forward(const stree::Arguments&, stree::DataPtr ant) {
-    ant_ptr(ant)->forward();
+    ant_ptr<A>(ant)->forward();
     return stree::Value();
 }
 
+template<typename A>
 stree::Value left(const stree::Arguments&, stree::DataPtr ant) {
-    ant_ptr(ant)->left();
+    ant_ptr<A>(ant)->left();
     return stree::Value();
 }
 
+template<typename A>
 stree::Value right(const stree::Arguments&, stree::DataPtr ant) {
-    ant_ptr(ant)->right();
+    ant_ptr<A>(ant)->right();
     return stree::Value();
 }
 
@@ -38,8 +176,18 @@ stree::Value progn(const stree::Arguments&, stree::DataPtr) {
     return stree::Value();
 }
 
+template<typename A>
 unsigned if_food_ahead(const stree::Arguments&, stree::DataPtr ant) {
-    return ant_ptr(ant)->is_food_ahead() ? 0 : 1;
+    return ant_ptr<A>(ant)->is_food_ahead() ? 0 : 1;
 }
 
 }
+
+#define ANTVIEW_INSTANTIATE(World) \
+    template void init_environment<BasicAnt<World>>(stree::Environment&); \
+    template void run_tree(stree::Tree&, BasicAnt<World>&, unsigned); \
+    template bool check_program( \
+        stree::Tree&, const Program&, const BasicGrid<World>&, \
+        unsigned, std::ostream&);
+ANTVIEW_FOR_EACH_WORLD(ANTVIEW_INSTANTIATE)
+#undef ANTVIEW_INSTANTIATE
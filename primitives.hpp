@@ -1,16 +1,68 @@
 #ifndef ANTVIEW_PRIMITIVES_HPP_
 #define ANTVIEW_PRIMITIVES_HPP_
 
+#include <cstddef>
+#include <ostream>
+#include <string>
 #include <stree/stree.hpp>
+#include "ant.hpp"
+#include "flat_tree.hpp"
+#include "grid.hpp"
+#include "program.hpp"
 
+// Register primitives for ant type `A'
+template<typename A>
 void init_environment(stree::Environment& env);
 
+// Register primitives for Santa Fe sized world
+void init_environment(stree::Environment& env);
+
+// Run tree with stree::Exec in a loop until cost limit is exceeded
+template<typename A>
+void run_tree(stree::Tree& tree, A& ant, unsigned cost_limit);
+
+// Compile tree built of init_environment primitives, walks tree nodes
+Program compile_program(const stree::Tree& tree);
+
+// Same, into existing program, see Program::compile
+void compile_program(const stree::Tree& tree, Program& program);
+
+// Number of nodes and max. depth of a node, root is at depth 0
+struct TreeShape {
+    std::size_t size;
+    unsigned depth;
+};
+
+// Shape of tree built of init_environment primitives
+TreeShape tree_shape(const stree::Tree& tree);
+
+// Conversion between stree and flat trees of init_environment
+// primitives, both print the same s-expression; flat tree is made
+// from tree nodes
+FlatTree make_flat_tree(const stree::Tree& tree);
+stree::Tree make_tree(stree::Environment& env, const FlatTree& tree);
+
+// Run tree with stree::Exec and compiled program side by side
+// for `step_limit' actions, return false and print both ants to `os'
+// on first difference
+template<typename G>
+bool check_program(
+    stree::Tree& tree,
+    const Program& program,
+    const BasicGrid<G>& grid,
+    unsigned step_limit,
+    std::ostream& os);
+
 namespace ant {
 
+template<typename A>
 stree::Value forward(const stree::Arguments&, stree::DataPtr ant);
+template<typename A>
 stree::Value left(const stree::Arguments&, stree::DataPtr ant);
+template<typename A>
 stree::Value right(const stree::Arguments&, stree::DataPtr ant);
 stree::Value progn(const stree::Arguments&, stree::DataPtr ant);
+template<typename A>
 unsigned if_food_ahead(const stree::Arguments&, stree::DataPtr ant);
 
 }
@@ -0,0 +1,451 @@
+#include "program.hpp"
+#include <algorithm>
+#include <cassert>
+
+static void thread_jumps(Program::Code& code);
+
+// Empty code buffer reused by calling thread, compiled code is copied
+// out of it, so program gets a single allocation of exact size
+static Program::Code& code_buffer();
+
+// Compile tree of `num' nodes in prefix order into empty `code'
+template<typename N>
+static void compile_tree(const N* nodes, std::size_t num, Program::Code& code);
+
+// Compile node at `index', move `index' past its subtree
+template<typename N>
+static void compile_node(
+    const N* nodes,
+    std::size_t num,
+    std::size_t& index,
+    Program::Code& code);
+
+static const char* op_to_string(Program::Op op) {
+    switch (op) {
+        case Program::OpForward: return "forward";
+        case Program::OpLeft: return "left";
+        case Program::OpRight: return "right";
+        case Program::OpIfFoodAhead: return "if-food-ahead";
+        case Program::OpJump: return "jump";
+        default: assert(false);
+    }
+}
+
+std::ostream& operator<<(std::ostream& os, const Program& program) {
+    for (std::size_t i = 0; i < program.size(); ++i) {
+        const Program::Instr& instr = program.code()[i];
+        os << i << ": " << op_to_string(instr.op);
+        if (instr.op == Program::OpIfFoodAhead
+            || instr.op == Program::OpJump)
+        {
+            os << ' ' << instr.arg;
+        }
+        os << std::endl;
+    }
+    return os;
+}
+
+CycleDetector::CycleDetector(std::size_t cell_num)
+    : slot_num_(0),
+      epoch_(0),
+      food_eaten_(0)
+{
+    if (cell_num * 4 <= MaxStampNum) {
+        stamps_.assign(cell_num * 4, 0);
+    } else {
+        slots_.assign(1024, Slot{0, 0});
+    }
+}
+
+void CycleDetector::reset() {
+    next_epoch();
+    food_eaten_ = 0;
+}
+
+void CycleDetector::next_epoch() {
+    slot_num_ = 0;
+    if (++epoch_ == 0) {
+        std::fill(stamps_.begin(), stamps_.end(), 0);
+        for (Slot& slot : slots_)
+            slot.epoch = 0;
+        epoch_ = 1;
+    }
+}
+
+bool CycleDetector::visit_hashed(std::uint64_t key) {
+    std::size_t mask = slots_.size() - 1;
+    std::size_t index = (key * 0x9e3779b97f4a7c15ull) >> 40;
+    for (;; ++index) {
+        Slot& slot = slots_[index & mask];
+        if (slot.epoch != epoch_) {
+            slot.key = key;
+            slot.epoch = epoch_;
+            break;
+        }
+        if (slot.key == key)
+            return true;
+    }
+
+    // Keep load under 1/2
+    if (++slot_num_ * 2 > slots_.size()) {
+        std::vector<Slot> slots(slots_.size() * 2, Slot{0, 0});
+        mask = slots.size() - 1;
+        for (const Slot& slot : slots_) {
+            if (slot.epoch != epoch_)
+                continue;
+            index = (slot.key * 0x9e3779b97f4a7c15ull) >> 40;
+            while (slots[index & mask].epoch == epoch_)
+                ++index;
+            slots[index & mask] = slot;
+        }
+        slots_.swap(slots);
+    }
+    return false;
+}
+
+Pruner::Pruner(const DistanceMap* distances, unsigned food_num)
+    : distances_(distances),
+      food_num_(food_num)
+{
+    clear_threshold();
+}
+
+void Pruner::set_threshold(float threshold) {
+    // Least food left with fitness not below threshold,
+    // fitness is computed the same way as in evaluator
+    food_left_limit_ = 0;
+    while (food_left_limit_ <= food_num_
+           && static_cast<float>(food_left_limit_) / food_num_ < threshold)
+    {
+        ++food_left_limit_;
+    }
+}
+
+ProgramError::ProgramError(const std::string& what)
+    : std::invalid_argument(
+        std::string("Program error: ") + what) {}
+
+Program Program::compile(const std::string& source) {
+    return compile(FlatTree::parse(source));
+}
+
+Program Program::compile(const FlatTree& tree) {
+    Code& code = code_buffer();
+    compile_tree(tree.nodes().data(), tree.size(), code);
+    Program program;
+    program.code_.assign(code.begin(), code.end());
+    return program;
+}
+
+Program Program::compile(const std::vector<FlatTree::Op>& ops) {
+    Code& code = code_buffer();
+    compile_tree(ops.data(), ops.size(), code);
+    Program program;
+    program.code_.assign(code.begin(), code.end());
+    return program;
+}
+
+void Program::compile(const FlatTree& tree, Program& program) {
+    program.code_.clear();
+    compile_tree(tree.nodes().data(), tree.size(), program.code_);
+}
+
+void Program::compile(const std::vector<FlatTree::Op>& ops, Program& program) {
+    program.code_.clear();
+    compile_tree(ops.data(), ops.size(), program.code_);
+}
+
+template<typename A>
+unsigned Program::step(A& ant, unsigned pc) const {
+    assert(!code_.empty());
+    for (;;) {
+        const Instr& instr = code_[pc];
+        switch (instr.op) {
+            case OpForward:
+                ant.forward();
+                return pc + 1;
+            case OpLeft:
+                ant.left();
+                return pc + 1;
+            case OpRight:
+                ant.right();
+                return pc + 1;
+            case OpIfFoodAhead:
+                pc = ant.is_food_ahead() ? pc + 1 : instr.arg;
+                break;
+            case OpJump:
+                pc = instr.arg;
+                break;
+        }
+    }
+}
+
+// Interpreter loop, saves checkpoints if `Traced'
+template<bool Traced, typename A>
+static RunStatus run_code(
+    const Program::Instr* code,
+    A& ant,
+    unsigned pc,
+    unsigned step_limit,
+    RunChecks* checks,
+    unsigned interval,
+    RunTrace* trace,
+    unsigned pc_max)
+{
+    unsigned checkpoint_at = ant.action_num();
+    while (ant.action_num() < step_limit) {
+        if (Traced) {
+            pc_max = std::max(pc_max, pc);
+            if (ant.action_num() >= checkpoint_at) {
+                trace->checkpoints.push_back({ant.state(), pc, pc_max});
+                checkpoint_at = ant.action_num() + interval;
+            }
+        }
+        if (pc == 0 && checks) {
+            RunStatus status = checks->check(
+                ant, step_limit - ant.action_num());
+            if (status != RunDone)
+                return status;
+        }
+        const Program::Instr& instr = code[pc];
+        switch (instr.op) {
+            case Program::OpForward:
+                ant.forward();
+                ++pc;
+                break;
+            case Program::OpLeft:
+                ant.left();
+                ++pc;
+                break;
+            case Program::OpRight:
+                ant.right();
+                ++pc;
+                break;
+            case Program::OpIfFoodAhead:
+                pc = ant.is_food_ahead() ? pc + 1 : instr.arg;
+                break;
+            case Program::OpJump:
+                pc = instr.arg;
+                break;
+        }
+    }
+    return RunDone;
+}
+
+template<typename A>
+static void save_cells(const A& ant, RunTrace& trace) {
+    unsigned num = ant.food_eaten();
+    if (num > AntBase::UndoLogSize)
+        num = AntBase::UndoLogSize;
+    trace.cells.assign(ant.eaten_cells(), ant.eaten_cells() + num);
+}
+
+template<typename A>
+RunStatus Program::run(
+    A& ant,
+    unsigned step_limit,
+    RunChecks* checks) const
+{
+    assert(!code_.empty());
+    if (checks)
+        checks->reset();
+    return run_code<false>(
+        code_.data(), ant, 0, step_limit, checks, 0, nullptr, 0);
+}
+
+template<typename A>
+RunStatus Program::run(
+    A& ant,
+    unsigned step_limit,
+    RunChecks* checks,
+    unsigned interval,
+    RunTrace& trace) const
+{
+    assert(!code_.empty());
+    assert(interval > 0);
+    trace.checkpoints.clear();
+    trace.resumed = 0;
+    if (checks)
+        checks->reset();
+    RunStatus status = run_code<true>(
+        code_.data(), ant, 0, step_limit, checks, interval, &trace, 0);
+    save_cells(ant, trace);
+    return status;
+}
+
+template<typename A>
+RunStatus Program::resume(
+    A& ant,
+    unsigned step_limit,
+    RunChecks* checks,
+    unsigned interval,
+    const Program& parent,
+    const RunTrace& parent_trace,
+    RunTrace& trace) const
+{
+    assert(!code_.empty());
+    assert(interval > 0);
+
+    // Find last checkpoint saved before leaving common prefix,
+    // checkpoints are ordered by `pc_max' and action number
+    std::size_t prefix = common_prefix(*this, parent);
+    std::size_t num = 0;
+    while (num < parent_trace.checkpoints.size()) {
+        const RunTrace::Checkpoint& checkpoint = parent_trace.checkpoints[num];
+        if (checkpoint.pc_max >= prefix
+            || checkpoint.state.action_num > step_limit
+            || checkpoint.state.food_eaten > parent_trace.cells.size())
+        {
+            break;
+        }
+        ++num;
+    }
+    if (num == 0)
+        return run(ant, step_limit, checks, interval, trace);
+
+    // Checkpoints up to resume point are valid for this program too
+    trace.checkpoints.assign(
+        parent_trace.checkpoints.begin(),
+        parent_trace.checkpoints.begin() + num);
+    // Last checkpoint is saved again at resume point
+    RunTrace::Checkpoint checkpoint = trace.checkpoints.back();
+    trace.checkpoints.pop_back();
+    ant.restore(checkpoint.state, parent_trace.cells.data());
+    trace.resumed = checkpoint.state.action_num;
+
+    // NOTE: cycle detector history before resume point is lost,
+    // cycles are detected later (if at all)
+    if (checks)
+        checks->reset();
+    RunStatus status = run_code<true>(
+        code_.data(), ant, checkpoint.pc, step_limit, checks,
+        interval, &trace, checkpoint.pc_max);
+    save_cells(ant, trace);
+    return status;
+}
+
+std::size_t Program::common_prefix(const Program& a, const Program& b) {
+    std::size_t size = std::min(a.size(), b.size());
+    std::size_t prefix = 0;
+    while (prefix < size && a.code_[prefix].op == b.code_[prefix].op)
+        ++prefix;
+    // Shrink until all jumps inside prefix agree
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (std::size_t i = 0; i < prefix; ++i) {
+            const Instr& instr_a = a.code_[i];
+            const Instr& instr_b = b.code_[i];
+            bool is_jump = (instr_a.op == OpIfFoodAhead || instr_a.op == OpJump);
+            if (is_jump
+                && instr_a.arg != instr_b.arg
+                && std::min(instr_a.arg, instr_b.arg) < prefix)
+            {
+                prefix = i;
+                changed = true;
+                break;
+            }
+        }
+    }
+    return prefix;
+}
+
+#define ANTVIEW_INSTANTIATE(World) \
+    template unsigned Program::step( \
+        BasicAnt<World>&, unsigned) const; \
+    template RunStatus Program::run( \
+        BasicAnt<World>&, unsigned, RunChecks*) const; \
+    template RunStatus Program::run( \
+        BasicAnt<World>&, unsigned, RunChecks*, unsigned, RunTrace&) const; \
+    template RunStatus Program::resume( \
+        BasicAnt<World>&, unsigned, RunChecks*, unsigned, \
+        const Program&, const RunTrace&, RunTrace&) const;
+ANTVIEW_FOR_EACH_WORLD(ANTVIEW_INSTANTIATE)
+#undef ANTVIEW_INSTANTIATE
+
+static FlatTree::Op node_op(const FlatTree::Node& node) {
+    return node.op;
+}
+
+static FlatTree::Op node_op(FlatTree::Op op) {
+    return op;
+}
+
+template<typename N>
+void compile_tree(const N* nodes, std::size_t num, Program::Code& code) {
+    if (num == 0)
+        throw ProgramError("empty tree");
+    std::size_t index = 0;
+    compile_node(nodes, num, index, code);
+    if (index < num)
+        throw ProgramError("unexpected nodes after tree end");
+    if (code.size() >= Program::MaxSize)
+        throw ProgramError("program is too long");
+    // Loop
+    code.emplace_back(Program::OpJump, 0);
+    thread_jumps(code);
+}
+
+template<typename N>
+void compile_node(
+    const N* nodes,
+    std::size_t num,
+    std::size_t& index,
+    Program::Code& code)
+{
+    if (index == num)
+        throw ProgramError("missing arguments");
+    switch (node_op(nodes[index++])) {
+        case FlatTree::OpForward:
+            code.emplace_back(Program::OpForward);
+            break;
+        case FlatTree::OpLeft:
+            code.emplace_back(Program::OpLeft);
+            break;
+        case FlatTree::OpRight:
+            code.emplace_back(Program::OpRight);
+            break;
+        case FlatTree::OpIfFoodAhead: {
+            std::size_t branch = code.size();
+            code.emplace_back(Program::OpIfFoodAhead);
+            compile_node(nodes, num, index, code);
+            std::size_t jump = code.size();
+            code.emplace_back(Program::OpJump);
+            code[branch].arg = code.size();
+            compile_node(nodes, num, index, code);
+            code[jump].arg = code.size();
+            break;
+        }
+        case FlatTree::OpProgn2:
+            compile_node(nodes, num, index, code);
+            compile_node(nodes, num, index, code);
+            break;
+        case FlatTree::OpProgn3:
+            compile_node(nodes, num, index, code);
+            compile_node(nodes, num, index, code);
+            compile_node(nodes, num, index, code);
+            break;
+        default:
+            assert(false);
+    }
+}
+
+Program::Code& code_buffer() {
+    thread_local Program::Code code;
+    code.clear();
+    return code;
+}
+
+// Retarget branches and jumps pointing to other jumps.
+// All jumps go forward except the final one, and the first instruction
+// is never a jump, so this always terminates.
+void thread_jumps(Program::Code& code) {
+    for (Program::Instr& instr : code) {
+        if (instr.op != Program::OpIfFoodAhead
+            && instr.op != Program::OpJump)
+        {
+            continue;
+        }
+        while (code[instr.arg].op == Program::OpJump)
+            instr.arg = code[instr.arg].arg;
+    }
+}
@@ -0,0 +1,279 @@
+#ifndef ANTVIEW_PROGRAM_HPP_
+#define ANTVIEW_PROGRAM_HPP_
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "ant.hpp"
+#include "flat_tree.hpp"
+
+class ProgramError : public std::invalid_argument {
+public:
+    explicit ProgramError(const std::string& what);
+};
+
+class Program;
+std::ostream& operator<<(std::ostream& os, const Program& program);
+
+// Detects repeated ant states at program start.
+// Execution state at program start is (position, direction, food left),
+// so if the same position and direction come up again with no food
+// eaten in between, the ant will loop forever without eating.
+class CycleDetector {
+public:
+    // Detector for world with `cell_num' cells, large worlds
+    // use a hash table instead of a stamp per state
+    explicit CycleDetector(std::size_t cell_num = World32::CellNum);
+
+    // Start new run
+    void reset();
+
+    // Call at program start, return true if state repeats
+    template<typename A>
+    bool is_cycle(const A& ant) {
+        // Food eaten, older states cannot repeat
+        if (ant.food_eaten() != food_eaten_) {
+            food_eaten_ = ant.food_eaten();
+            next_epoch();
+        }
+        std::uint64_t key = std::uint64_t(ant.cell()) * 4 + ant.dir();
+        if (stamps_.empty())
+            return visit_hashed(key);
+        assert(key < stamps_.size());
+        if (stamps_[key] == epoch_)
+            return true;
+        stamps_[key] = epoch_;
+        return false;
+    }
+
+private:
+    // Max. number of stamps for dense table
+    static const std::size_t MaxStampNum = 1 << 20;
+
+    // Visited state in hash table
+    struct Slot {
+        std::uint64_t key;
+        std::uint32_t epoch;
+    };
+
+    void next_epoch();
+
+    // Mark as visited in hash table, return true if already visited
+    bool visit_hashed(std::uint64_t key);
+
+    // Epoch of last visit for each (position, direction),
+    // empty for large worlds
+    std::vector<std::uint32_t> stamps_;
+    // Open addressing, slots with current epoch are in use
+    std::vector<Slot> slots_;
+    std::size_t slot_num_;
+    std::uint32_t epoch_;
+    unsigned food_eaten_;
+};
+
+// Detects runs that cannot end with less food left than a threshold.
+// An ant needs at least as many steps as the distance to nearest food
+// (on the initial grid) to eat anything, then at least one step
+// for each next food item.
+class Pruner {
+public:
+    Pruner(const DistanceMap* distances, unsigned food_num);
+
+    // Prune runs that cannot get fitness below `threshold'
+    void set_threshold(float threshold);
+
+    void clear_threshold() {
+        food_left_limit_ = food_num_ + 1;
+    }
+
+    // Least food left possible after `steps_left' more actions
+    template<typename A>
+    unsigned food_left_bound(const A& ant, unsigned steps_left) const {
+        // Food at current cell is already eaten
+        unsigned distance = std::max(1u, distances_->get(ant.x(), ant.y()));
+        unsigned food_max = (steps_left >= distance)
+            ? steps_left - distance + 1
+            : 0;
+        return (food_max < ant.food_left())
+            ? ant.food_left() - food_max
+            : 0;
+    }
+
+    template<typename A>
+    bool is_hopeless(const A& ant, unsigned steps_left) const {
+        return food_left_bound(ant, steps_left) >= food_left_limit_;
+    }
+
+private:
+    const DistanceMap* distances_;
+    unsigned food_num_;
+    unsigned food_left_limit_;
+};
+
+enum RunStatus {
+    RunDone,   // step limit reached
+    RunCycle,  // stopped on cycle
+    RunPruned  // stopped as hopeless
+};
+
+// Checks done each time program starts over
+struct RunChecks {
+    RunChecks()
+        : detector(nullptr),
+          pruner(nullptr) {}
+
+    void reset() {
+        if (detector)
+            detector->reset();
+    }
+
+    template<typename A>
+    RunStatus check(const A& ant, unsigned steps_left) {
+        if (detector && detector->is_cycle(ant))
+            return RunCycle;
+        if (pruner && pruner->is_hopeless(ant, steps_left))
+            return RunPruned;
+        return RunDone;
+    }
+
+    CycleDetector* detector;
+    const Pruner* pruner;
+};
+
+// Checkpoints saved during a run.
+// A program that behaves the same way up to some instruction can
+// resume from a checkpoint saved before that instruction was reached.
+struct RunTrace {
+    struct Checkpoint {
+        AntBase::State state;
+        unsigned pc;     // next instruction
+        unsigned pc_max; // max. instruction index reached so far
+    };
+
+    RunTrace()
+        : resumed(0) {}
+
+    // Forget checkpoints, keep buffers
+    void clear() {
+        checkpoints.clear();
+        cells.clear();
+        resumed = 0;
+    }
+
+    // Make room for a run without reallocation
+    void reserve(std::size_t checkpoint_num, std::size_t cell_num) {
+        checkpoints.reserve(checkpoint_num);
+        cells.reserve(cell_num);
+    }
+
+    std::vector<Checkpoint> checkpoints;
+    std::vector<AntBase::Cell> cells; // eaten cells in order
+    unsigned resumed; // number of actions skipped by resuming
+};
+
+// Ant program compiled to linear bytecode.
+// Last instruction jumps back to the start, so the program runs in a
+// loop like stree::Exec with FlagRunLoop.
+class Program {
+public:
+    enum Op : std::uint8_t {
+        OpForward,
+        OpLeft,
+        OpRight,
+        OpIfFoodAhead, // continue if food ahead, jump to `arg' otherwise
+        OpJump         // jump to `arg'
+    };
+
+    struct Instr {
+        Instr(Op op, std::uint16_t arg = 0)
+            : op(op), arg(arg) {}
+
+        bool operator==(const Instr& other) const {
+            return op == other.op && arg == other.arg;
+        }
+
+        Op op;
+        std::uint16_t arg;
+    };
+
+    using Code = std::vector<Instr>;
+
+    static const std::size_t MaxSize = 0xffff;
+
+    // Compile program from s-expression, e.g.
+    // "(if-food-ahead (forward) (progn2 (left) (forward)))",
+    // parsed with FlatTree::parse; throws FlatTreeError on syntax error
+    static Program compile(const std::string& source);
+
+    // Compile flat tree, same code as for its s-expression
+    static Program compile(const FlatTree& tree);
+
+    // Compile tree given as operations in prefix order,
+    // same code as for flat tree
+    static Program compile(const std::vector<FlatTree::Op>& ops);
+
+    // Same, replacing code of existing `program', its code buffer
+    // is reused
+    static void compile(const FlatTree& tree, Program& program);
+    static void compile(const std::vector<FlatTree::Op>& ops, Program& program);
+
+    Program() {}
+
+    // Run from `pc' until an action is done, return next `pc'
+    template<typename A>
+    unsigned step(A& ant, unsigned pc) const;
+
+    // Run from the start until ant does `step_limit' actions
+    // or one of `checks' fails
+    template<typename A>
+    RunStatus run(
+        A& ant,
+        unsigned step_limit,
+        RunChecks* checks = nullptr) const;
+
+    // Same as run(), also save checkpoint to `trace' every `interval'
+    // actions
+    template<typename A>
+    RunStatus run(
+        A& ant,
+        unsigned step_limit,
+        RunChecks* checks,
+        unsigned interval,
+        RunTrace& trace) const;
+
+    // Resume from last usable checkpoint in `parent_trace' saved by
+    // `parent' program, run from the start if there is none.
+    // Ant must be reset.
+    template<typename A>
+    RunStatus resume(
+        A& ant,
+        unsigned step_limit,
+        RunChecks* checks,
+        unsigned interval,
+        const Program& parent,
+        const RunTrace& parent_trace,
+        RunTrace& trace) const;
+
+    // Number of leading instructions that make both programs behave
+    // the same way while executed: same operations, same jump targets
+    // or both targets outside the prefix
+    static std::size_t common_prefix(const Program& a, const Program& b);
+
+    const Code& code() const {
+        return code_;
+    }
+
+    std::size_t size() const {
+        return code_.size();
+    }
+
+private:
+    Code code_;
+};
+
+#endif
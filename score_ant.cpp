@@ -0,0 +1,294 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "data.hpp"
+#include "evaluator.hpp"
+#include "grid.hpp"
+#include "mapped_file.hpp"
+#include "parallel.hpp"
+#include "program.hpp"
+#include "trail.hpp"
+
+// Named item of input, name is filename or filename with index
+// if the file holds several items
+template<typename T>
+struct Named {
+    std::string name;
+    T value;
+};
+
+// Trail with side of its world, see load_trail()
+struct WorldTrail {
+    Trail trail;
+    Coord size;
+};
+
+using NamedProgram = Named<Program>;
+using NamedTrail = Named<WorldTrail>;
+
+// Result of running a program on a trail
+struct Score {
+    Fitness fitness;
+    unsigned steps; // actions done when last food item was eaten
+};
+
+static const unsigned DefaultStepLimit = 600;
+
+static void usage(const std::string& name);
+
+static std::vector<NamedProgram> load_programs_or_exit(const std::string& path);
+static std::vector<NamedTrail> load_trails_or_exit(const std::string& path);
+
+// Top-level s-expressions in source
+static std::vector<std::string> split_trees(const std::string& source);
+
+// Run each program on each trail in world `G',
+// result is row-major, row per program
+template<typename G>
+static std::vector<Score> score(
+    const std::vector<NamedProgram>& programs,
+    const std::vector<NamedTrail>& trails,
+    unsigned step_limit,
+    unsigned thread_num);
+
+template<typename A>
+static Score run(
+    const Program& program,
+    A& ant,
+    unsigned food_num,
+    unsigned step_limit,
+    RunChecks& checks);
+
+static void print_scores(
+    const std::vector<NamedProgram>& programs,
+    const std::vector<NamedTrail>& trails,
+    const std::vector<Score>& scores);
+
+int main(int argc, char** argv) {
+    if (argc < 3)
+        usage(argv[0]);
+    std::vector<NamedProgram> programs = load_programs_or_exit(argv[1]);
+    std::vector<NamedTrail> trails = load_trails_or_exit(argv[2]);
+    unsigned step_limit = (argc > 3) ? std::stoul(argv[3]) : DefaultStepLimit;
+    unsigned thread_num = thread_num_or_default(
+        (argc > 4) ? std::stoul(argv[4]) : 0);
+
+    Coord size = 0;
+    for (const NamedTrail& trail : trails)
+        size = std::max(size, trail.value.size);
+
+    std::vector<Score> scores = with_world(size, [&](auto world) {
+        return score<decltype(world)>(programs, trails, step_limit, thread_num);
+    });
+    print_scores(programs, trails, scores);
+    return 0;
+}
+
+
+void usage(const std::string& name) {
+    using namespace std;
+    cout << "Usage:" << endl
+         << name << " <tree-filename>[,<tree-filename>...]"
+         << " <trail-filename>[,<trail-filename>...]"
+         << " [<step-limit> [<threads>]]" << endl
+         << name << " <tree-directory> <trail-directory>"
+         << " [<step-limit> [<threads>]]" << endl
+         << "    tree file may hold many trees, e.g. one per line,"
+         << " trail file may hold many trails, `-' is stdin" << endl;
+    exit(-1);
+}
+
+std::vector<NamedProgram> load_programs_or_exit(const std::string& path) {
+    std::vector<NamedProgram> programs;
+    try {
+        for (const std::string& filename : list_trail_files(path)) {
+            std::string source;
+            if (filename == "-") {
+                source.assign(
+                    std::istreambuf_iterator<char>(std::cin),
+                    std::istreambuf_iterator<char>());
+            } else {
+                MappedFile file(filename);
+                source.assign(file.data(), file.size());
+            }
+            std::vector<std::string> trees = split_trees(source);
+            if (trees.empty())
+                throw std::invalid_argument(filename + ": no trees");
+            for (std::size_t i = 0; i < trees.size(); ++i) {
+                std::string name = (trees.size() > 1)
+                    ? filename + "#" + std::to_string(i)
+                    : filename;
+                try {
+                    programs.push_back({name, Program::compile(trees[i])});
+                } catch (const std::invalid_argument& e) {
+                    throw std::invalid_argument(name + ": " + e.what());
+                }
+            }
+        }
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        std::exit(-1);
+    }
+    return programs;
+}
+
+std::vector<NamedTrail> load_trails_or_exit(const std::string& path) {
+    std::vector<NamedTrail> trails;
+    std::string filename;
+    try {
+        for (const std::string& item : list_trail_files(path)) {
+            filename = item;
+            std::size_t first = trails.size();
+            auto add = [&](Trail& trail, Coord size) {
+                if (trail.size() == 0)
+                    throw std::invalid_argument("Trail is empty");
+                trails.push_back({filename, {std::move(trail), size}});
+            };
+            std::size_t num = read_trails(
+                filename,
+                [&](Trail& trail) {
+                    add(trail, world_size(trail));
+                },
+                [&](const BinaryTrail& trail) {
+                    Trail copy = trail.trail();
+                    add(copy, world_size(trail.width(), trail.height()));
+                });
+            if (num == 0)
+                throw std::invalid_argument("No trails");
+            if (num > 1) {
+                for (std::size_t i = 0; i < num; ++i)
+                    trails[first + i].name += "#" + std::to_string(i);
+            }
+        }
+    } catch (std::exception& e) {
+        std::cerr << filename << ": " << e.what() << std::endl;
+        std::exit(-1);
+    }
+    return trails;
+}
+
+std::vector<std::string> split_trees(const std::string& source) {
+    std::vector<std::string> trees;
+    std::size_t pos = 0;
+    while (pos < source.size()) {
+        // Skip space
+        if (std::isspace(static_cast<unsigned char>(source[pos]))) {
+            ++pos;
+            continue;
+        }
+        // Balanced parens or single symbol
+        std::size_t begin = pos;
+        unsigned depth = 0;
+        for (; pos < source.size(); ++pos) {
+            char c = source[pos];
+            if (c == '(') {
+                ++depth;
+            } else if (c == ')') {
+                if (depth == 0 || --depth == 0) {
+                    ++pos;
+                    break;
+                }
+            } else if (depth == 0
+                       && std::isspace(static_cast<unsigned char>(c)))
+            {
+                break;
+            }
+        }
+        // Unbalanced input is passed on to compiler to report
+        trees.push_back(source.substr(begin, pos - begin));
+    }
+    return trees;
+}
+
+template<typename G>
+std::vector<Score> score(
+    const std::vector<NamedProgram>& programs,
+    const std::vector<NamedTrail>& trails,
+    unsigned step_limit,
+    unsigned thread_num)
+{
+    // Evaluator copies share grids, each copy has its own ants
+    BasicEvaluator<G> evaluator(step_limit, EvalBytecode);
+    for (const NamedTrail& trail : trails)
+        evaluator.add_trail(trail.value.trail, trail.value.size);
+    evaluator.select_trails({});
+    EvaluatorList<G> evaluators(thread_num, evaluator);
+
+    std::vector<Score> scores(programs.size() * trails.size());
+    parallel_for(
+        programs.size(), thread_num,
+        [&](std::size_t begin, std::size_t end, unsigned thread_index) {
+            BasicEvaluator<G>& item = evaluators[thread_index];
+            RunChecks checks;
+            checks.detector = &item.detector;
+            for (std::size_t i = begin; i < end; ++i) {
+                for (std::size_t j = 0; j < item.cases.size(); ++j) {
+                    auto& fitness_case = item.cases[j];
+                    scores[i * trails.size() + j] = run(
+                        programs[i].value, fitness_case.ant,
+                        fitness_case.food_num, step_limit, checks);
+                }
+            }
+        },
+        1);
+    return scores;
+}
+
+template<typename A>
+Score run(
+    const Program& program,
+    A& ant,
+    unsigned food_num,
+    unsigned step_limit,
+    RunChecks& checks)
+{
+    // Same as Program::run, stops when trail is cleared
+    ant.reset();
+    checks.reset();
+    const Program::Code& code = program.code();
+    Score result{0.0, 0};
+    unsigned pc = 0;
+    while (ant.action_num() < step_limit && ant.food_left() > 0) {
+        while (code[pc].op == Program::OpJump)
+            pc = code[pc].arg;
+        if (pc == 0 && checks.check(ant, step_limit - ant.action_num()) != RunDone)
+            break; // no more food can be eaten
+        unsigned food_eaten = ant.food_eaten();
+        pc = program.step(ant, pc);
+        if (ant.food_eaten() != food_eaten)
+            result.steps = ant.action_num();
+    }
+    result.fitness = static_cast<Fitness>(ant.food_left()) / food_num;
+    return result;
+}
+
+void print_scores(
+    const std::vector<NamedProgram>& programs,
+    const std::vector<NamedTrail>& trails,
+    const std::vector<Score>& scores)
+{
+    // Tab separated, cell is "<fitness>/<steps>"
+    std::cout << "tree\tmean";
+    for (const NamedTrail& trail : trails)
+        std::cout << '\t' << trail.name;
+    std::cout << std::endl;
+
+    std::cout << std::fixed << std::setprecision(4);
+    for (std::size_t i = 0; i < programs.size(); ++i) {
+        const Score* row = &scores[i * trails.size()];
+        Fitness sum = 0.0;
+        for (std::size_t j = 0; j < trails.size(); ++j)
+            sum += row[j].fitness;
+        std::cout << programs[i].name << '\t' << sum / trails.size();
+        for (std::size_t j = 0; j < trails.size(); ++j)
+            std::cout << '\t' << row[j].fitness << '/' << row[j].steps;
+        std::cout << '\n';
+    }
+    std::cout.flush();
+}
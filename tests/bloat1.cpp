@@ -0,0 +1,81 @@
+#include <iostream>
+#include <random>
+#include <vector>
+#include "../bloat.hpp"
+#include "../flat_tree.hpp"
+
+int main() {
+    using namespace std;
+
+    // Size and depth limits, zero is no limit
+    std::mt19937 prng(1);
+    BloatControl limits(20, 3, ParsimonyNone, 0.0, 3);
+    BloatControl no_limits(0, 0, ParsimonyNone, 0.0, 3);
+    for (unsigned i = 0; i < 1000; ++i) {
+        FlatTree tree = FlatTree::random(prng, 5, false);
+        bool fits = (tree.size() <= 20 && tree.depth() <= 3);
+        if (limits.fits(tree.size(), tree.depth()) != fits
+            || !no_limits.fits(tree.size(), tree.depth()))
+        {
+            cerr << "Limits: size " << tree.size()
+                 << ", depth " << tree.depth() << endl;
+            return -1;
+        }
+    }
+
+    // Lexicographic parsimony: smaller tree wins on equal fitness,
+    // fitness goes first
+    std::vector<std::size_t> sizes{10, 5, 20};
+    std::vector<float> fitness{0.5, 0.5, 0.4};
+    auto get_fitness = [&fitness](std::size_t index) {
+        return fitness[index];
+    };
+    BloatControl lexicographic(0, 0, ParsimonyLexicographic, 0.0, 50);
+    BloatControl none(0, 0, ParsimonyNone, 0.0, 50);
+    for (unsigned i = 0; i < 100; ++i) {
+        if (tournament(sizes, get_fitness, lexicographic, 50, false, prng) != 2
+            || tournament(sizes, get_fitness, lexicographic, 50, true, prng) != 0)
+        {
+            cerr << "Lexicographic tournament" << endl;
+            return -1;
+        }
+    }
+    fitness[2] = 0.5;
+    unsigned smaller_num = 0;
+    for (unsigned i = 0; i < 100; ++i) {
+        if (tournament(sizes, get_fitness, lexicographic, 50, false, prng) != 1) {
+            cerr << "Lexicographic tournament, equal fitness" << endl;
+            return -1;
+        }
+        if (tournament(sizes, get_fitness, none, 50, false, prng) == 1)
+            ++smaller_num;
+    }
+    // Without parsimony first one drawn wins
+    if (smaller_num == 0 || smaller_num == 100) {
+        cerr << "Tournament without parsimony: smaller tree won "
+             << smaller_num << " times" << endl;
+        return -1;
+    }
+
+    // Tarpeian method kills only larger than average trees,
+    // at given rate
+    BloatControl tarpeian(0, 0, ParsimonyTarpeian, 0.3, 3);
+    unsigned killed_num = 0;
+    for (unsigned i = 0; i < 10000; ++i) {
+        if (tarpeian.is_killed(10, 10.0, prng)
+            || tarpeian.is_killed(5, 10.0, prng))
+        {
+            cerr << "Tarpeian method killed a tree of average size" << endl;
+            return -1;
+        }
+        if (tarpeian.is_killed(11, 10.0, prng))
+            ++killed_num;
+    }
+    if (killed_num < 2800 || killed_num > 3200) {
+        cerr << "Tarpeian method killed " << killed_num
+             << " of 10000 trees" << endl;
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,129 @@
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../flat_tree.hpp"
+#include "../program.hpp"
+
+static std::string to_string(const FlatTree& tree) {
+    std::ostringstream ss;
+    ss << tree;
+    return ss.str();
+}
+
+// Tree is printed and parsed back unchanged, made back from its
+// operations unchanged, compiles to the same code as its s-expression
+// and its operations, subtree sizes are consistent
+static bool check(const FlatTree& tree, const char* what) {
+    using namespace std;
+    string source = to_string(tree);
+    if (FlatTree::parse(source) != tree) {
+        cerr << what << ": parsed tree differs: " << source << endl;
+        return false;
+    }
+    if (Program::compile(tree).code() != Program::compile(source).code()) {
+        cerr << what << ": compiled code differs: " << source << endl;
+        return false;
+    }
+    const FlatTree::Nodes& nodes = tree.nodes();
+    std::vector<FlatTree::Op> ops;
+    for (const FlatTree::Node& node : nodes)
+        ops.push_back(node.op);
+    if (FlatTree::from_ops(ops) != tree) {
+        cerr << what << ": tree from operations differs: " << source << endl;
+        return false;
+    }
+    if (Program::compile(ops).code() != Program::compile(tree).code()) {
+        cerr << what << ": code compiled from operations differs: "
+             << source << endl;
+        return false;
+    }
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        std::size_t end = i + 1;
+        for (unsigned j = 0; j < FlatTree::arity(nodes[i].op); ++j)
+            end += nodes[end].size;
+        if (end != i + nodes[i].size) {
+            cerr << what << ": wrong subtree size at " << i << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    using namespace std;
+
+    string solution(
+        "(if-food-ahead (progn3 (forward) (forward) (right))"
+        " (progn2 (progn2 (progn3 (left) (forward) (left))"
+        " (if-food-ahead (forward) (right))) (right)))");
+
+    FlatTree tree = FlatTree::parse(solution);
+    cout << "Parsed tree: " << tree << endl;
+    if (to_string(tree) != solution) {
+        cerr << "Printed tree differs" << endl;
+        return -1;
+    }
+    if (tree.size() != 15 || tree.depth() != 4) {
+        cerr << "Size " << tree.size() << ", depth " << tree.depth() << endl;
+        return -1;
+    }
+    if (!check(tree, "solution"))
+        return -1;
+
+    // Operators
+    std::mt19937 prng(1);
+    for (unsigned i = 0; i < 1000; ++i) {
+        FlatTree a = FlatTree::random(prng, 5, i % 2 == 0);
+        FlatTree b = FlatTree::random(prng, 5, false);
+        if (i % 2 == 0 && a.depth() != 5) {
+            cerr << "Full tree depth is " << a.depth() << endl;
+            return -1;
+        }
+        if (!check(a, "random")
+            || !check(FlatTree::crossover(a, b, prng), "crossover")
+            || !check(a.mutate_subtree(prng, 3), "subtree mutation")
+            || !check(a.mutate_point(prng), "point mutation")
+            || !check(a.mutate_hoist(prng), "hoist mutation"))
+        {
+            return -1;
+        }
+    }
+
+    // Operations that are not a single tree
+    using Ops = std::vector<FlatTree::Op>;
+    for (const Ops& ops : {
+            Ops{},
+            Ops{FlatTree::OpProgn2, FlatTree::OpLeft},
+            Ops{FlatTree::OpLeft, FlatTree::OpRight}})
+    {
+        try {
+            Program::compile(ops);
+            cerr << "No error for " << ops.size() << " operations" << endl;
+            return -1;
+        } catch (const ProgramError& e) {
+            cout << e.what() << endl;
+        }
+        try {
+            FlatTree::from_ops(ops);
+            cerr << "No error for " << ops.size() << " operations" << endl;
+            return -1;
+        } catch (const FlatTreeError& e) {
+            cout << e.what() << endl;
+        }
+    }
+
+    // Parse errors
+    for (const char* source : {"(progn2 (left))", "progn2", "(jump)", "(left"}) {
+        try {
+            FlatTree::parse(source);
+            cerr << "No error for " << source << endl;
+            return -1;
+        } catch (const FlatTreeError& e) {
+            cout << e.what() << endl;
+        }
+    }
+
+    return 0;
+}
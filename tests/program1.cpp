@@ -0,0 +1,68 @@
+#include <iostream>
+#include <string>
+#include <stree/stree.hpp>
+#include "../ant.hpp"
+#include "../grid.hpp"
+#include "../primitives.hpp"
+#include "../program.hpp"
+#include "../trail_parser.hpp"
+
+int main() {
+    using namespace std;
+
+    stree::Environment env;
+    init_environment(env);
+
+    std::string ant_str(
+        "(if-food-ahead (progn3 (forward) (forward) (right))"
+        " (progn2 (progn2 (progn3 (left) (forward) (left))"
+        " (if-food-ahead (forward) (right))) (right)))");
+    std::string trail_str(
+        "((0 0) (1 0) (2 0) (3 0) (3 1) (3 2) (4 2) (5 2) (5 3)"
+        " (5 4) (5 5) (4 5) (3 5) (2 6) (1 7) (0 7) (31 7))");
+
+    // Parse trail
+    TrailParser trail_parser;
+    trail_parser.parse(trail_str);
+    if (!trail_parser.is_done()) {
+        cerr << "Cannot parse trail" << endl;
+        return -1;
+    }
+    Grid grid(trail_parser.result());
+
+    // Parse ant program
+    stree::Parser parser(&env);
+    parser.parse(ant_str);
+    if (!parser.is_done()) {
+        cerr << "Cannot parse ant program" << endl;
+        return -1;
+    }
+
+    // Make tree
+    stree::Tree tree(&env, parser.result());
+    cout << "Ant program: " << tree << endl;
+
+    // Shape from tree nodes
+    TreeShape shape = tree_shape(tree);
+    if (shape.size != 15 || shape.depth != 4) {
+        cerr << "Tree size " << shape.size
+             << ", depth " << shape.depth << endl;
+        return -1;
+    }
+
+    // Compile
+    Program program = compile_program(tree);
+    cout << "Bytecode:" << endl << program;
+
+    // Compare with stree::Exec
+    if (!check_program(tree, program, grid, 600, cerr)) {
+        cerr << "Compiled program trajectory differs" << endl;
+        return -1;
+    }
+
+    Ant ant(grid);
+    program.run(ant, 600);
+    cout << ant << endl;
+
+    return 0;
+}
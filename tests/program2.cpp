@@ -0,0 +1,69 @@
+#include <iostream>
+#include <string>
+#include "../ant.hpp"
+#include "../grid.hpp"
+#include "../program.hpp"
+#include "../trail_parser.hpp"
+
+static bool same(const Ant& ant1, const Ant& ant2) {
+    return ant1.dir() == ant2.dir()
+        && ant1.x() == ant2.x()
+        && ant1.y() == ant2.y()
+        && ant1.food_eaten() == ant2.food_eaten()
+        && ant1.action_num() == ant2.action_num();
+}
+
+int main() {
+    using namespace std;
+
+    // Child differs from parent in last subtree
+    std::string parent_str(
+        "(if-food-ahead (forward)"
+        " (progn2 (right) (if-food-ahead (forward) (progn2 (left) (left)))))");
+    std::string child_str(
+        "(if-food-ahead (forward)"
+        " (progn2 (right) (if-food-ahead (forward) (progn2 (left) (forward)))))");
+    std::string trail_str(
+        "((0 0) (1 0) (2 0) (3 0) (3 1) (3 2) (4 2) (5 2) (5 3)"
+        " (5 4) (5 5) (4 5) (3 5) (2 6) (1 7) (0 7) (31 7))");
+
+    // Parse trail
+    TrailParser trail_parser;
+    trail_parser.parse(trail_str);
+    if (!trail_parser.is_done()) {
+        cerr << "Cannot parse trail" << endl;
+        return -1;
+    }
+    Grid grid(trail_parser.result());
+
+    Program parent = Program::compile(parent_str);
+    Program child = Program::compile(child_str);
+    cout << "Common prefix: "
+         << Program::common_prefix(parent, child) << endl;
+
+    // Run parent with checkpoints
+    Ant ant(&grid);
+    RunTrace parent_trace;
+    parent.run(ant, 600, nullptr, 2, parent_trace);
+    cout << "Parent: " << ant << endl;
+
+    // Resume child
+    ant.reset();
+    RunTrace trace;
+    child.resume(ant, 600, nullptr, 2, parent, parent_trace, trace);
+    cout << "Child: " << ant << ", resumed at " << trace.resumed << endl;
+    if (trace.resumed == 0) {
+        cerr << "Child is not resumed" << endl;
+        return -1;
+    }
+
+    // Compare with full run
+    Ant ant_full(&grid);
+    child.run(ant_full, 600);
+    if (!same(ant, ant_full)) {
+        cerr << "Resumed run differs from full run: " << ant_full << endl;
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,163 @@
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "../data.hpp"
+#include "../grid.hpp"
+#include "../trail.hpp"
+#include "../trail_format.hpp"
+
+static void put_le(std::string& data, std::uint64_t value, unsigned size) {
+    for (unsigned i = 0; i < size; ++i)
+        data.push_back(static_cast<char>((value >> (i * 8)) & 0xff));
+}
+
+// Binary trail made by hand, positions in given order
+static std::string make_binary(
+    std::uint32_t version,
+    std::uint32_t width,
+    std::uint32_t height,
+    const std::vector<Pos>& positions)
+{
+    std::string data(BinaryTrailMagic, sizeof(BinaryTrailMagic));
+    put_le(data, version, 4);
+    put_le(data, width, 4);
+    put_le(data, height, 4);
+    put_le(data, positions.size(), 8);
+    for (const Pos& pos : positions) {
+        put_le(data, pos.first, 2);
+        put_le(data, pos.second, 2);
+    }
+    return data;
+}
+
+static std::string write_file(const std::string& data) {
+    char filename[] = "/tmp/trail_format1.XXXXXX";
+    int fd = mkstemp(filename);
+    if (fd == -1 || write(fd, data.data(), data.size()) != (ssize_t) data.size()) {
+        std::cerr << "Cannot write temporary file" << std::endl;
+        std::exit(-1);
+    }
+    close(fd);
+    return filename;
+}
+
+// Load trail from file with given contents
+static Trail load(const std::string& data, Coord& size) {
+    std::string filename = write_file(data);
+    try {
+        Trail trail = load_trail(filename, size);
+        unlink(filename.c_str());
+        return trail;
+    } catch (...) {
+        unlink(filename.c_str());
+        throw;
+    }
+}
+
+// Data is rejected, both in memory and on load
+static bool is_rejected(const std::string& data, const char* what) {
+    using namespace std;
+    if (is_binary_trail(data.data(), data.size())) {
+        try {
+            BinaryTrail trail(data.data(), data.size());
+            cerr << what << ": no error in memory" << endl;
+            return false;
+        } catch (const std::invalid_argument& e) {
+            cout << what << ": " << e.what() << endl;
+        }
+    }
+    try {
+        Coord size;
+        load(data, size);
+        cerr << what << ": no error on load" << endl;
+        return false;
+    } catch (const std::exception& e) {
+        cout << what << ": " << e.what() << endl;
+    }
+    return true;
+}
+
+int main() {
+    using namespace std;
+
+    // Round trip, world is kept even if trail uses only its corner
+    Trail corner{{0, 0}, {1, 0}, {5, 7}, {31, 2}};
+    ostringstream os;
+    write_binary_trail(os, corner, 4096, 4096);
+    string data = os.str();
+    Coord size = 0;
+    if (load(data, size) != corner || size != 4096) {
+        cerr << "Binary round trip failed, size " << size << endl;
+        return -1;
+    }
+    BinaryTrail binary(data.data(), data.size());
+    SparseGrid sparse(binary);
+    if (sparse.width() != 4096 || sparse.height() != 4096
+        || sparse.trail() != corner)
+    {
+        cerr << "Sparse grid from binary trail differs" << endl;
+        return -1;
+    }
+    try {
+        Grid grid(binary);
+        cerr << "4096x4096 world fits 32x32 grid" << endl;
+        return -1;
+    } catch (const std::out_of_range& e) {
+        cout << e.what() << endl;
+    }
+
+    // Text trail is in the smallest world containing it
+    ostringstream text;
+    text << corner << endl;
+    if (load(text.str(), size) != corner || size != 32) {
+        cerr << "Text trail size is " << size << endl;
+        return -1;
+    }
+
+    // Positions in any order, with duplicates
+    Trail expected{{0, 0}, {1, 2}, {5, 5}, {31, 31}};
+    data = make_binary(
+        BinaryTrailVersion, 32, 32, {{5, 5}, {31, 31}, {1, 2}, {5, 5}, {0, 0}});
+    BinaryTrail unsorted(data.data(), data.size());
+    Grid grid(unsorted);
+    if (unsorted.trail() != expected || grid.trail() != expected
+        || grid.count() != expected.size()
+        || load(data, size) != expected || size != 32)
+    {
+        cerr << "Unsorted trail differs" << endl;
+        return -1;
+    }
+
+    // Invalid files
+    data = make_binary(BinaryTrailVersion, 64, 64, {{1, 1}, {2, 2}});
+    string bad_magic = data;
+    bad_magic[0] = 'X';
+    if (!is_rejected(data.substr(0, data.size() - 1), "truncated positions")
+        || !is_rejected(data.substr(0, 20), "truncated header")
+        || !is_rejected(bad_magic, "bad magic")
+        || !is_rejected(make_binary(2, 64, 64, {{1, 1}}), "bad version")
+        || !is_rejected(make_binary(BinaryTrailVersion, 0, 64, {}), "empty world")
+        || !is_rejected(
+            make_binary(BinaryTrailVersion, 32, 32, {{1, 1}, {32, 0}}),
+            "position outside the world"))
+    {
+        return -1;
+    }
+
+    // Writer checks the world
+    try {
+        write_binary_trail(os, corner, 16, 16);
+        cerr << "Trail is written outside the world" << endl;
+        return -1;
+    } catch (const std::out_of_range& e) {
+        cout << e.what() << endl;
+    }
+
+    return 0;
+}
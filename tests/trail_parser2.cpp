@@ -0,0 +1,160 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../trail_parser.hpp"
+#include "../trail.hpp"
+
+// Parse first trail in `source' split into buffers
+// at increasing `splits'
+static TrailParser parse_split(
+    const std::string& source,
+    std::vector<std::size_t> splits)
+{
+    TrailParser parser;
+    std::size_t begin = 0;
+    splits.push_back(source.size());
+    for (std::size_t end : splits) {
+        // Parsing after done trail would start next one
+        if (parser.is_done() || parser.is_error())
+            break;
+        parser.parse(source.data() + begin, end - begin);
+        begin = end;
+    }
+    parser.finish();
+    return parser;
+}
+
+// Reference: one character at a time, without in-place numbers
+static TrailParser parse_chars(const std::string& source) {
+    TrailParser parser;
+    for (char c : source) {
+        if (parser.is_done() || parser.is_error())
+            break;
+        parser.consume(c);
+    }
+    parser.finish();
+    return parser;
+}
+
+static bool same(TrailParser& parser1, TrailParser& parser2) {
+    return parser1.state() == parser2.state()
+        && parser1.error() == parser2.error()
+        && parser1.result() == parser2.result()
+        && parser1.line_num() == parser2.line_num()
+        && parser1.char_num() == parser2.char_num();
+}
+
+static bool check_error(
+    const std::string& source,
+    TrailParser::Error error,
+    std::size_t line_num,
+    std::size_t char_num)
+{
+    using namespace std;
+    // Whole buffer and each single split
+    for (std::size_t split = 0; split <= source.size(); ++split) {
+        TrailParser parser = parse_split(source, {split});
+        if (parser.error() != error
+            || parser.line_num() != line_num
+            || parser.char_num() != char_num)
+        {
+            cerr << source << " split at " << split << ": "
+                 << parser.error_message()
+                 << " at line " << parser.line_num()
+                 << " char " << parser.char_num() << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Random trail text, coordinates may be too large
+static std::string random_source(std::mt19937& prng) {
+    std::uniform_int_distribution<unsigned> item_num(0, 20);
+    std::uniform_int_distribution<unsigned> kind(0, 19);
+    std::uniform_int_distribution<Coord> coord(0, MaxWorldSize - 1);
+    const char* spaces[] = {" ", "  ", "\n", " \t", "\r\n"};
+    std::uniform_int_distribution<unsigned> space(0, 4);
+
+    std::string source("(");
+    unsigned num = item_num(prng);
+    for (unsigned i = 0; i < num; ++i) {
+        source += spaces[space(prng)];
+        source += '(';
+        for (unsigned j = 0; j < 2; ++j) {
+            if (j > 0)
+                source += spaces[space(prng)];
+            switch (kind(prng)) {
+                case 0: source += "99999999999999999999"; break;
+                case 1: source += std::to_string(MaxWorldSize); break;
+                case 2: source += "0000" + std::to_string(coord(prng)); break;
+                default: source += std::to_string(coord(prng));
+            }
+        }
+        source += ')';
+    }
+    source += ')';
+    return source;
+}
+
+int main() {
+    using namespace std;
+
+    // Number split between buffers
+    string source("((12 0) (1234 56789))");
+    Trail expected{{12, 0}, {1234, 56789}};
+    for (std::size_t split = 0; split <= source.size(); ++split) {
+        TrailParser parser = parse_split(source, {split});
+        if (!parser.is_done() || parser.result() != expected) {
+            cerr << "Split at " << split << ": " << parser.result() << endl;
+            return -1;
+        }
+    }
+
+    // Errors and their positions, line and char are counted from 0 and 1
+    if (!check_error("((99999999999 0))", TrailParser::ErrorNumberOutOfRange, 0, 14)
+        || !check_error("((0 65536))", TrailParser::ErrorNumberOutOfRange, 0, 10)
+        || !check_error("((0 0)\n (1 x))", TrailParser::ErrorUnrecognizedSymbol, 1, 5)
+        || !check_error("((0 0) (1 2 3))", TrailParser::ErrorUnexpectedDigit, 0, 13)
+        || !check_error("((0 (1 2))", TrailParser::ErrorUnexpectedLeftParen, 0, 5)
+        || !check_error("((0 0)\n(1 2)", TrailParser::ErrorUnexpectedEnd, 1, 5))
+    {
+        return -1;
+    }
+    TrailParser parser;
+    parser.parse(string("((65535 65535))"));
+    if (!parser.is_done()) {
+        cerr << "Largest coordinates: " << parser.error_message() << endl;
+        return -1;
+    }
+
+    // Random trails in random buffers, same result as one character
+    // at a time
+    std::mt19937 prng(1);
+    for (unsigned i = 0; i < 2000; ++i) {
+        string source = random_source(prng);
+        // Some are broken
+        if (i % 4 == 0) {
+            std::uniform_int_distribution<std::size_t> pos(0, source.size() - 1);
+            source[pos(prng)] = "x()0"[i % 16 / 4];
+        }
+        std::vector<std::size_t> splits;
+        std::uniform_int_distribution<std::size_t> step(1, 8);
+        for (std::size_t split = step(prng); split < source.size(); split += step(prng))
+            splits.push_back(split);
+
+        TrailParser parser1 = parse_split(source, splits);
+        TrailParser parser2 = parse_chars(source);
+        if (!same(parser1, parser2)) {
+            cerr << "Results differ for " << source << endl
+                 << parser1.error_message() << " at line " << parser1.line_num()
+                 << " char " << parser1.char_num() << endl
+                 << parser2.error_message() << " at line " << parser2.line_num()
+                 << " char " << parser2.char_num() << endl;
+            return -1;
+        }
+    }
+
+    return 0;
+}
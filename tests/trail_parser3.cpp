@@ -0,0 +1,105 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../trail_parser.hpp"
+#include "../trail.hpp"
+
+// All trails from reader, false on error
+static bool read_all(TrailReader& reader, std::vector<Trail>& trails) {
+    trails.clear();
+    Trail trail;
+    try {
+        while (reader.next(trail))
+            trails.push_back(trail);
+    } catch (const TrailParserException&) {
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    using namespace std;
+
+    // Trails are separated by any space, or by nothing
+    string corpus(
+        "((0 0) (1 0) (2 0))\n"
+        "((5 5))((7 8) (12345 3))\n"
+        "\n"
+        "  ()\t((0 1)\n (0 2))  \n");
+    vector<Trail> expected{
+        {{0, 0}, {1, 0}, {2, 0}},
+        {{5, 5}},
+        {{7, 8}, {12345, 3}},
+        {},
+        {{0, 1}, {0, 2}}};
+
+    // Memory
+    TrailReader reader(corpus.data(), corpus.size());
+    vector<Trail> trails;
+    if (!read_all(reader, trails) || trails != expected) {
+        cerr << "Memory: " << trails.size() << " trails" << endl;
+        return -1;
+    }
+
+    // Stream, every block size splits trails and numbers differently
+    for (std::size_t block_size = 1; block_size <= corpus.size(); ++block_size) {
+        istringstream is(corpus);
+        TrailReader reader(is, block_size);
+        if (!read_all(reader, trails) || trails != expected) {
+            cerr << "Block size " << block_size << ": "
+                 << trails.size() << " trails" << endl;
+            return -1;
+        }
+    }
+
+    // Parser starts next trail after done one, position goes on
+    TrailParser parser;
+    std::size_t num = parser.parse(corpus.data(), corpus.size());
+    if (!parser.is_done() || parser.result() != expected[0]) {
+        cerr << "First trail is not done" << endl;
+        return -1;
+    }
+    parser.parse(corpus.data() + num, corpus.size() - num);
+    if (!parser.is_done() || parser.result() != expected[1]
+        || parser.line_num() != 1 || parser.char_num() != 7)
+    {
+        cerr << "Second trail: " << parser.state_string()
+             << " at line " << parser.line_num()
+             << " char " << parser.char_num() << endl;
+        return -1;
+    }
+
+    // Truncated last trail is an error, not end of input
+    for (const char* source : {"((0 0)) ((1", "((0 0)) ((1 1)", "((0 0)) ("}) {
+        for (std::size_t block_size : {1, 3, 64}) {
+            istringstream is(source);
+            TrailReader reader(is, block_size);
+            Trail trail;
+            try {
+                if (!reader.next(trail) || trail != Trail{{0, 0}}) {
+                    cerr << "No first trail in " << source << endl;
+                    return -1;
+                }
+                reader.next(trail);
+                cerr << "No error for " << source << endl;
+                return -1;
+            } catch (const TrailParserException& e) {
+                if (string(e.what()).find("Unexpected end of input") == string::npos) {
+                    cerr << "Wrong error for " << source << ": " << e.what() << endl;
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // Empty input
+    istringstream is("  \n");
+    TrailReader empty_reader(is);
+    if (!read_all(empty_reader, trails) || !trails.empty()) {
+        cerr << "Empty input" << endl;
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,18 @@
+#include "trail.hpp"
+
+std::ostream& operator<<(std::ostream& os, const Trail& trail) {
+    os << '(';
+    auto it = trail.begin();
+    for (; it != trail.end();) {
+        os << (*it);
+        ++it;
+        if (it != trail.end())
+            os << ' ';
+    }
+    os << ')';
+    return os;
+}
+
+std::ostream& operator<<(std::ostream& os, const Pos& pos) {
+    return os << '(' << pos.first << ' ' << pos.second << ')';
+}
@@ -0,0 +1,15 @@
+#ifndef ANTVIEW_TRAIL_HPP_
+#define ANTVIEW_TRAIL_HPP_
+
+#include <set>
+#include <utility>
+#include <ostream>
+
+using Coord = int;
+using Pos = std::pair<Coord, Coord>;
+using Trail = std::set<Pos>;
+
+std::ostream& operator<<(std::ostream& os, const Trail& trail);
+std::ostream& operator<<(std::ostream& os, const Pos& pos);
+
+#endif
@@ -11,7 +11,7 @@ int main(int argc, char** argv) {
     TrailEditorApp app;
     if (argc > 1)
         app.set_trail(load_trail_or_exit(argv[1]));
-    app.run("Trail Editor", Ant::MaxX * 32, Ant::MaxY * 32);
+    app.run("Trail Editor", app.width(), app.height());
     return 0;
 }
 
@@ -0,0 +1,105 @@
+#include "trail_format.hpp"
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "geometry.hpp"
+
+static void put_le(std::vector<char>& buffer, std::uint64_t value, unsigned size);
+static std::uint64_t get_le(const char* data, unsigned size);
+
+void write_binary_trail(
+    std::ostream& os, const Trail& trail, Coord width, Coord height)
+{
+    if (width <= 0 || width > MaxWorldSize || height <= 0 || height > MaxWorldSize)
+        throw std::out_of_range(
+            "Invalid world size " + std::to_string(width)
+            + "x" + std::to_string(height));
+
+    std::vector<char> buffer;
+    buffer.reserve(sizeof(BinaryTrailHeader) + trail.size() * 4);
+    buffer.insert(buffer.end(), BinaryTrailMagic, BinaryTrailMagic + 4);
+    put_le(buffer, BinaryTrailVersion, 4);
+    put_le(buffer, width, 4);
+    put_le(buffer, height, 4);
+    put_le(buffer, trail.size(), 8);
+    for (const Pos& pos : trail) {
+        if (pos.first < 0 || pos.first >= width
+            || pos.second < 0 || pos.second >= height)
+        {
+            throw std::out_of_range("Position outside the world");
+        }
+        put_le(buffer, pos.first, 2);
+        put_le(buffer, pos.second, 2);
+    }
+    os.write(buffer.data(), buffer.size());
+}
+
+bool is_binary_trail(const char* data, std::size_t size) {
+    return size >= sizeof(BinaryTrailMagic)
+        && std::memcmp(data, BinaryTrailMagic, sizeof(BinaryTrailMagic)) == 0;
+}
+
+BinaryTrail::BinaryTrail(const char* data, std::size_t size)
+    : positions_(data + sizeof(BinaryTrailHeader))
+{
+    if (size < sizeof(BinaryTrailHeader) || !is_binary_trail(data, size))
+        throw std::invalid_argument("Not a binary trail");
+
+    std::memcpy(header_.magic, data, sizeof(header_.magic));
+    header_.version = get_le(data + 4, 4);
+    header_.width = get_le(data + 8, 4);
+    header_.height = get_le(data + 12, 4);
+    header_.count = get_le(data + 16, 8);
+
+    if (header_.version != BinaryTrailVersion)
+        throw std::invalid_argument(
+            "Unsupported binary trail version "
+            + std::to_string(header_.version));
+    const std::uint32_t max_size = MaxWorldSize;
+    if (header_.width == 0 || header_.width > max_size
+        || header_.height == 0 || header_.height > max_size)
+    {
+        throw std::invalid_argument("Invalid binary trail world size");
+    }
+    if (header_.count > (size - sizeof(BinaryTrailHeader)) / 4)
+        throw std::invalid_argument("Binary trail is truncated");
+
+    // Users trust positions, checking them is a scan without copying
+    for (std::size_t i = 0; i < this->size(); ++i) {
+        Pos pos = (*this)[i];
+        if (pos.first >= width() || pos.second >= height())
+            throw std::invalid_argument(
+                "Binary trail position " + std::to_string(i)
+                + " is outside the world");
+    }
+}
+
+Pos BinaryTrail::operator[](std::size_t index) const {
+    assert(index < size());
+    const char* data = positions_ + index * 4;
+    return Pos(get_le(data, 2), get_le(data + 2, 2));
+}
+
+Trail BinaryTrail::trail() const {
+    Trail trail;
+    for (std::size_t i = 0; i < size(); ++i) {
+        // Constant time if positions are in order,
+        // any order gives the same trail
+        trail.emplace_hint(trail.end(), (*this)[i]);
+    }
+    return trail;
+}
+
+void put_le(std::vector<char>& buffer, std::uint64_t value, unsigned size) {
+    for (unsigned i = 0; i < size; ++i)
+        buffer.push_back(static_cast<char>((value >> (i * 8)) & 0xff));
+}
+
+std::uint64_t get_le(const char* data, unsigned size) {
+    std::uint64_t value = 0;
+    for (unsigned i = 0; i < size; ++i)
+        value |= std::uint64_t(static_cast<unsigned char>(data[i])) << (i * 8);
+    return value;
+}
@@ -0,0 +1,68 @@
+#ifndef ANTVIEW_TRAIL_FORMAT_HPP_
+#define ANTVIEW_TRAIL_FORMAT_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include "trail.hpp"
+
+// Binary trail file, all numbers are little-endian:
+//   header: magic "ANTT", version, width, height (uint32), count (uint64)
+//   body: `count' positions, x and y as uint16
+// Trail is in a world of at least stored size, unlike text trails
+// that are in the smallest world containing them, see world_size().
+// Writer puts positions in Trail order, readers don't rely on it.
+struct BinaryTrailHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint64_t count;
+};
+
+static_assert(sizeof(BinaryTrailHeader) == 24, "Unexpected header padding");
+
+const char BinaryTrailMagic[4] = {'A', 'N', 'T', 'T'};
+const std::uint32_t BinaryTrailVersion = 3;
+
+// Write trail in world of given size;
+// throws std::out_of_range if world size is invalid or a position
+// is outside the world
+void write_binary_trail(
+    std::ostream& os, const Trail& trail, Coord width, Coord height);
+
+// Check if data starts with binary trail magic
+bool is_binary_trail(const char* data, std::size_t size);
+
+// Binary trail in memory, e.g. mapped file. Positions are decoded
+// in place on access, data must outlive the object.
+class BinaryTrail {
+public:
+    // Check header and positions;
+    // throws std::invalid_argument if data is not a valid trail
+    BinaryTrail(const char* data, std::size_t size);
+
+    Coord width() const {
+        return header_.width;
+    }
+
+    Coord height() const {
+        return header_.height;
+    }
+
+    // Number of positions
+    std::size_t size() const {
+        return header_.count;
+    }
+
+    Pos operator[](std::size_t index) const;
+
+    // Copy of positions
+    Trail trail() const;
+
+private:
+    BinaryTrailHeader header_;
+    const char* positions_;
+};
+
+#endif
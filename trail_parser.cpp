@@ -1,14 +1,25 @@
 #include "trail_parser.hpp"
+#include <array>
 #include <cassert>
-#include <cstring>
+#include <charconv>
 
-const char Space[] = " \t\r\n";
-const char Digits[] = "0123456789";
+enum CharClass : unsigned char {
+    ClassOther,
+    ClassSpace,
+    ClassDigit,
+    ClassParenLeft,
+    ClassParenRight
+};
 
-static bool is_space(char c);
-static bool is_digit(char c);
-static bool is_paren_left(char c);
-static bool is_paren_right(char c);
+using CharClassTable = std::array<CharClass, 256>;
+
+static CharClassTable make_char_classes();
+
+static const CharClassTable CharClasses = make_char_classes();
+
+static CharClass char_class(char c) {
+    return CharClasses[static_cast<unsigned char>(c)];
+}
 
 static std::string state_message(const TrailParser& parser) {
     return std::string("")
@@ -26,13 +37,35 @@ TrailParser::TrailParser() {
     reset();
 }
 
-std::size_t TrailParser::parse(const std::string& s) {
-    std::size_t pos = 0;
-    for (; pos < s.size(); ++pos) {
-        consume(s[pos]);
-        if (is_done() || is_error())
-            break;
+std::size_t TrailParser::parse(const char* data, std::size_t size) {
+    const char* end = data + size;
+    const char* p = data;
+    if (p < end && state_ == StateDone)
+        restart();
+    while (p < end && !is_done() && !is_error()) {
+        // Whole number inside the buffer: convert in place,
+        // digits are not copied
+        if (state_ == StateExpectNumber && char_class(*p) == ClassDigit) {
+            const char* number_end = p + 1;
+            while (number_end < end && char_class(*number_end) == ClassDigit)
+                ++number_end;
+            if (number_end < end) {
+                char_num_ += number_end - p;
+                number_begin_ = p;
+                number_end_ = number_end;
+                state_ = StateNumber;
+                p = number_end;
+                continue;
+            }
+        }
+        consume(*p++);
     }
+    number_begin_ = number_end_ = nullptr;
+    return p - data;
+}
+
+std::size_t TrailParser::parse(const std::string& s) {
+    std::size_t pos = parse(s.data(), s.size());
     finish();
     return pos;
 }
@@ -40,8 +73,10 @@ std::size_t TrailParser::parse(const std::string& s) {
 std::size_t TrailParser::parse(std::istream& s) {
     std::size_t pos = 0;
     char c = '\0';
-    while (!is_done() && !is_error() && s.get(c))
+    while (!is_done() && !is_error() && s.get(c)) {
         consume(c);
+        ++pos;
+    }
     return pos;
 }
 
@@ -49,30 +84,43 @@ void TrailParser::consume(const char c) {
     if (state_ == StateError) {
         return;
     } else if (state_ == StateDone) {
-        reset();
+        restart();
     }
 
     count(c);
 
-    if (is_space(c)) {
-        space();
-
-    } else if (is_digit(c)) {
-        digit(c);
-
-    } else if (is_paren_left(c)) {
-        paren_left();
-
-    } else if (is_paren_right(c)) {
-        paren_right();
-
-    } else {
-        set_error(ErrorUnrecognizedSymbol);
+    switch (char_class(c)) {
+        case ClassSpace:
+            space();
+            break;
+        case ClassDigit:
+            digit(c);
+            break;
+        case ClassParenLeft:
+            paren_left();
+            break;
+        case ClassParenRight:
+            paren_right();
+            break;
+        case ClassOther:
+            set_error(ErrorUnrecognizedSymbol);
+            break;
     }
 }
 
 void TrailParser::finish() {
-
+    switch (state_) {
+        case StateReady:
+        case StateError:
+        case StateDone:
+            break;
+        case StateNumber:
+        case StateExpectItemOrTrailEnd:
+        case StateExpectNumber:
+        case StateExpectItemEnd:
+            set_error(ErrorUnexpectedEnd);
+            break;
+    }
 }
 
 std::string TrailParser::state_string() const {
@@ -112,19 +160,26 @@ std::string TrailParser::error_message() const {
             return "Invalid number";
         case ErrorNumberOutOfRange:
             return "Number is out of range";
+        case ErrorUnexpectedEnd:
+            return "Unexpected end of input";
         default:
             assert(false && "Undefined error");
     }
 }
 
 void TrailParser::reset() {
+    restart();
+    error_ = ErrorOk;
+    line_num_ = 0;
+    char_num_ = 0;
+}
+
+void TrailParser::restart() {
     trail_.clear();
     coord_num_ = 0;
     state_ = StateReady;
-    error_ = ErrorOk;
     buffer_.clear();
-    line_num_ = 0;
-    char_num_ = 0;
+    number_begin_ = number_end_ = nullptr;
 }
 
 void TrailParser::space() {
@@ -207,7 +262,8 @@ void TrailParser::paren_right() {
             complete_number();
             if (state_ == StateExpectItemEnd) {
                 complete_pos();
-            } else {
+            } else if (state_ != StateError) {
+                // Keep number error
                 set_error(ErrorUnexpectedRightParen);
             }
             break;
@@ -229,18 +285,29 @@ void TrailParser::count(char c) {
 }
 
 void TrailParser::complete_number() {
-    // Parse number in buffer
+    // Parse digits in input or in buffer
+    const char* begin = number_begin_;
+    const char* end = number_end_;
+    if (!begin) {
+        begin = buffer_.data();
+        end = begin + buffer_.size();
+    }
     auto number = Coord{};
-    try {
-        number = std::stoi(buffer_);
-    } catch (const std::invalid_argument&) {
+    auto result = std::from_chars(begin, end, number);
+    if (result.ec == std::errc::result_out_of_range) {
+        set_error(ErrorNumberOutOfRange);
+    } else if (result.ec != std::errc() || result.ptr != end) {
         set_error(ErrorNumberInvalid);
-    } catch (const std::out_of_range&) {
+    } else if (number >= MaxWorldSize) {
+        // Coordinates must fit the largest world
         set_error(ErrorNumberOutOfRange);
     }
 
     // Clear buffer
     buffer_.clear();
+    number_begin_ = number_end_ = nullptr;
+    if (state_ == StateError)
+        return;
 
     // Update position coordinate
     switch (coord_num_) {
@@ -265,8 +332,8 @@ void TrailParser::complete_number() {
 
 void TrailParser::complete_pos() {
     assert(state_ == StateExpectItemEnd);
-    // Add position to trail
-    trail_.insert(pos_);
+    // Add position to trail, files are usually sorted
+    trail_.emplace_hint(trail_.end(), pos_);
     state_ = StateExpectItemOrTrailEnd;
 }
 
@@ -275,18 +342,53 @@ void TrailParser::set_error(TrailParser::Error error) {
     error_ = error;
 }
 
-bool is_space(char c) {
-    return std::strchr(Space, c);
-}
 
-bool is_digit(char c) {
-    return std::strchr(Digits, c);
+TrailReader::TrailReader(const char* data, std::size_t size)
+    : is_(nullptr),
+      pos_(data),
+      end_(data + size) {}
+
+TrailReader::TrailReader(std::istream& is, std::size_t block_size)
+    : is_(&is),
+      block_(block_size),
+      pos_(nullptr),
+      end_(nullptr) {}
+
+bool TrailReader::next(Trail& trail) {
+    for (;;) {
+        if (pos_ == end_ && !fill()) {
+            parser_.finish();
+            if (parser_.is_error())
+                throw TrailParserException(parser_);
+            return false;
+        }
+        pos_ += parser_.parse(pos_, end_ - pos_);
+        if (parser_.is_error())
+            throw TrailParserException(parser_);
+        if (parser_.is_done()) {
+            trail = parser_.move_result();
+            return true;
+        }
+    }
 }
 
-bool is_paren_left(char c) {
-    return c == '(';
+bool TrailReader::fill() {
+    if (!is_)
+        return false;
+    is_->read(block_.data(), block_.size());
+    pos_ = block_.data();
+    end_ = pos_ + is_->gcount();
+    return pos_ != end_;
 }
 
-bool is_paren_right(char c) {
-    return c == ')';
+CharClassTable make_char_classes() {
+    CharClassTable classes;
+    classes.fill(ClassOther);
+    for (char c : {' ', '\t', '\r', '\n'})
+        classes[static_cast<unsigned char>(c)] = ClassSpace;
+    for (char c = '0'; c <= '9'; ++c)
+        classes[static_cast<unsigned char>(c)] = ClassDigit;
+    classes['('] = ClassParenLeft;
+    classes[')'] = ClassParenRight;
+    return classes;
 }
@@ -5,6 +5,7 @@
 #include <istream>
 #include <stdexcept>
 #include <string>
+#include <vector>
 #include "ant.hpp"
 
 class TrailParser;
@@ -34,21 +35,35 @@ public:
         ErrorUnexpectedLeftParen,
         ErrorUnexpectedRightParen,
         ErrorNumberInvalid,
-        ErrorNumberOutOfRange
+        ErrorNumberOutOfRange,
+        ErrorUnexpectedEnd
     };
 
     TrailParser();
 
+    // Parse characters until trail is done or error occurs,
+    // return number of characters consumed.
+    // Buffer may end inside a trail, next call continues.
+    std::size_t parse(const char* data, std::size_t size);
     std::size_t parse(const std::string& s);
     std::size_t parse(std::istream& s);
     void consume(const char c);
 
+    // End of input, trail must be done or not started
     void finish();
 
     Trail result() {
         return trail_;
     }
 
+    Trail move_result() {
+        return std::move(trail_);
+    }
+
+    State state() const {
+        return state_;
+    }
+
     bool is_done() {
         return state_ == StateDone;
     }
@@ -79,6 +94,9 @@ public:
 private:
     void reset();
 
+    // Start next trail after done one, position is not reset
+    void restart();
+
     void space();
     void digit(const char c);
     void paren_left();
@@ -95,10 +113,35 @@ private:
     unsigned coord_num_;
     State state_;
     Error error_;
-    std::string buffer_;
+    std::string buffer_; // digits of number split between buffers
+
+    // Digits of number inside current buffer
+    const char* number_begin_;
+    const char* number_end_;
 
     std::size_t line_num_;
     std::size_t char_num_;
 };
 
+// Successive trails from memory or from a stream, the stream is read
+// in blocks, only the trail being parsed is kept
+class TrailReader {
+public:
+    TrailReader(const char* data, std::size_t size);
+    explicit TrailReader(std::istream& is, std::size_t block_size = 1 << 16);
+
+    // Get next trail, return false at end of input;
+    // throws TrailParserException on error
+    bool next(Trail& trail);
+
+private:
+    bool fill();
+
+    std::istream* is_;
+    std::vector<char> block_;
+    const char* pos_;
+    const char* end_;
+    TrailParser parser_;
+};
+
 #endif